@@ -2,7 +2,12 @@
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
 
+#include "handler/multithread.h"
 #include "handler/settings.h"
 #include "handler/webget.h"
 #include "parser/config/proxy.h"
@@ -27,6 +32,70 @@ int explodeConf(const std::string &filepath, std::vector<Proxy> &nodes)
     return explodeConfContent(fileGet(filepath), nodes);
 }
 
+/// last parse result of each subscription, keyed by its fetch cache identity
+struct ParseMemoSlot
+{
+    std::shared_ptr<const SubParseMemo> memo;
+    size_t bytes = 0;
+    uint64_t last_used = 0;
+};
+
+static std::mutex parse_memo_mutex;
+static std::map<std::string, ParseMemoSlot> parse_memos;
+static uint64_t parse_memo_clock = 0;
+static size_t parse_memo_total = 0;
+static constexpr size_t parse_memo_limit = 64;
+static constexpr size_t parse_memo_budget = 64 * 1024 * 1024;
+
+/// parse a subscription body, reusing whatever did not change since the last fetch of it
+static int explodeSubscription(const std::string &identity, const std::string &content, std::vector<Proxy> &nodes)
+{
+    std::shared_ptr<const SubParseMemo> previous;
+    {
+        guarded_mutex guard(parse_memo_mutex);
+        auto iter = parse_memos.find(identity);
+        if(iter != parse_memos.end())
+        {
+            previous = iter->second.memo;
+            iter->second.last_used = ++parse_memo_clock;
+        }
+    }
+    if(previous && previous->texts.front() == content)
+    {
+        nodes.insert(nodes.end(), previous->nodes.begin(), previous->nodes.end());
+        return !nodes.empty();
+    }
+    auto current = std::make_shared<SubParseMemo>();
+    int result = explodeConfContent(content, nodes, previous.get(), *current);
+    if(result)
+    {
+        size_t bytes = current->bytes();
+        guarded_mutex guard(parse_memo_mutex);
+        auto iter = parse_memos.find(identity);
+        if(iter != parse_memos.end())
+        {
+            parse_memo_total -= iter->second.bytes;
+            parse_memos.erase(iter);
+        }
+        //a body too large for the budget is parsed from scratch every time
+        if(bytes > parse_memo_budget)
+            return result;
+        while(!parse_memos.empty() && (parse_memos.size() >= parse_memo_limit || parse_memo_total + bytes > parse_memo_budget))
+        {
+            //drop the subscription that was parsed least recently
+            auto oldest = std::min_element(parse_memos.begin(), parse_memos.end(), [](const auto &a, const auto &b)
+            {
+                return a.second.last_used < b.second.last_used;
+            });
+            parse_memo_total -= oldest->second.bytes;
+            parse_memos.erase(oldest);
+        }
+        parse_memo_total += bytes;
+        parse_memos[identity] = {std::move(current), bytes, ++parse_memo_clock};
+    }
+    return result;
+}
+
 void copyNodes(std::vector<Proxy> &source, std::vector<Proxy> &dest)
 {
     std::move(source.begin(), source.end(), std::back_inserter(dest));
@@ -37,8 +106,8 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID, parse_
     std::string &proxy = *parse_set.proxy, &subInfo = *parse_set.sub_info;
     string_array &exclude_remarks = *parse_set.exclude_remarks;
     string_array &include_remarks = *parse_set.include_remarks;
-    RegexMatchConfigs &stream_rules = *parse_set.stream_rules;
-    RegexMatchConfigs &time_rules = *parse_set.time_rules;
+    const RegexReplacers &stream_rules = *parse_set.stream_rules;
+    const RegexReplacers &time_rules = *parse_set.time_rules;
     string_icase_map *request_headers = parse_set.request_header;
     bool &authorized = parse_set.authorized;
 
@@ -59,10 +128,10 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID, parse_
             string_array args = split(link.substr(7), ",");
             if(args.size() >= 1)
             {
-                std::string script = fileGet(args[0], false);
+                FileView script = fileView(args[0], false);
                 try
                 {
-                    ctx.eval(script);
+                    script_eval(ctx, script.view());
                     args.erase(args.begin()); /// remove script path
                     auto parse = (std::function<std::string(const std::string&, const string_array&)>) ctx.eval("parse");
                     switch(args.size())
@@ -88,7 +157,7 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID, parse_
                 }
             }
         }
-    }, global.scriptCleanContext);
+    }, global.scriptCleanContext, "link");
             /*
             duk_context *ctx = duktape_init();
             defer(duk_destroy_heap(ctx);)
@@ -161,7 +230,8 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID, parse_
         if(!strSub.empty())
         {
             writeLog(LOG_TYPE_INFO, "Parsing subscription data...");
-            if(explodeConfContent(strSub, nodes) == 0)
+            std::string identity = webCacheIdentity(link, proxy, request_headers, FetchPurpose::SubscriptionProvider);
+            if(explodeSubscription(identity, strSub, nodes) == 0)
             {
                 writeLog(LOG_TYPE_ERROR, "Invalid subscription from " +
                                          describeFetchTarget(link, FetchPurpose::SubscriptionProvider) + "!");
@@ -376,40 +446,99 @@ void filterNodes(std::vector<Proxy> &nodes, string_array &exclude_remarks, strin
     writeLog(LOG_TYPE_INFO, "Filter done.");
 }
 
-void nodeRename(Proxy &node, const RegexMatchConfigs &rename_array, extra_settings &ext)
+/// Evaluate a node script once and collect `name(node)` for every node, or the
+/// array returned by a single `nameAll(nodes)` call when the script defines one.
+/// Nodes whose call fails are left with an empty result.
+static bool runNodeScript(const std::string &rule_script, const std::string &name, const ProxyRefs &nodes, string_array &results, extra_settings &ext)
+{
+    /// path: scripts come from the shared file buffers, an inline one is used where it is
+    FileView script = startsWith(rule_script, "path:") ? fileView(rule_script.substr(5), true) : FileView(nullptr, rule_script);
+    bool success = false;
+    script_safe_runner(ext.js_runtime, ext.js_context, [&](qjs::Context &ctx)
+    {
+        try
+        {
+            /// a batch function left behind by an earlier script must not shadow this one
+            ctx.eval("globalThis." + name + "All = undefined");
+            script_eval(ctx, script.view());
+            results.clear();
+            if((std::string) ctx.eval("typeof " + name + "All") == "function")
+            {
+                auto batch = (std::function<string_array(const ProxyRefs&)>) ctx.eval(name + "All");
+                ScriptNodeScope scope(ctx);
+                results = batch(nodes);
+                if(results.size() != nodes.size())
+                {
+                    writeLog(0, name + "All() returned " + std::to_string(results.size()) + " results for " + std::to_string(nodes.size()) + " nodes, ignoring.", LOG_LEVEL_ERROR);
+                    results.clear();
+                    return;
+                }
+            }
+            else
+            {
+                auto single = (std::function<std::string(const Proxy&)>) ctx.eval(name);
+                results.reserve(nodes.size());
+                for(const Proxy *x : nodes)
+                {
+                    try
+                    {
+                        ScriptNodeScope scope(ctx);
+                        results.emplace_back(single(*x));
+                    }
+                    catch (qjs::exception)
+                    {
+                        script_print_stack(ctx);
+                        results.emplace_back();
+                    }
+                }
+            }
+            success = true;
+        }
+        catch (qjs::exception)
+        {
+            script_print_stack(ctx);
+        }
+    }, global.scriptCleanContext, name.c_str());
+    return success;
+}
+
+void nodeRename(std::vector<Proxy> &nodes, const RegexMatchConfigs &rename_array, extra_settings &ext)
 {
-    std::string &remark = node.Remark, original_remark = node.Remark, returned_remark, real_rule;
+    string_array original_remarks, returned_remarks;
+    std::string real_rule;
+    original_remarks.reserve(nodes.size());
+    for(const Proxy &x : nodes)
+        original_remarks.emplace_back(x.Remark);
 
     for(const RegexMatchConfig &x : rename_array)
     {
         if(!x.Script.empty() && ext.authorized)
         {
-            script_safe_runner(ext.js_runtime, ext.js_context, [&](qjs::Context &ctx)
+            ProxyRefs refs;
+            refs.reserve(nodes.size());
+            for(const Proxy &node : nodes)
+                refs.push_back(&node);
+            if(runNodeScript(x.Script, "rename", refs, returned_remarks, ext))
             {
-                std::string script = x.Script;
-                if(startsWith(script, "path:"))
-                    script = fileGet(script.substr(5), true);
-                try
-                {
-                    ctx.eval(script);
-                    auto rename = (std::function<std::string(const Proxy&)>) ctx.eval("rename");
-                    returned_remark = rename(node);
-                    if(!returned_remark.empty())
-                        remark = returned_remark;
-                }
-                catch (qjs::exception)
+                for(size_t i = 0; i < nodes.size(); i++)
                 {
-                    script_print_stack(ctx);
+                    if(!returned_remarks[i].empty())
+                        nodes[i].Remark = std::move(returned_remarks[i]);
                 }
-            }, global.scriptCleanContext);
+            }
             continue;
         }
-        if(applyMatcher(x.Match, real_rule, node) && real_rule.size())
-            remark = regReplace(remark, real_rule, x.Replace);
+        for(Proxy &node : nodes)
+        {
+            if(applyMatcher(x.Match, real_rule, node) && real_rule.size())
+                node.Remark = regReplace(node.Remark, real_rule, x.Replace);
+        }
+    }
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        if(nodes[i].Remark.empty())
+            nodes[i].Remark = std::move(original_remarks[i]);
     }
-    if(remark.empty())
-        remark = original_remark;
-    return;
 }
 
 std::string removeEmoji(const std::string &orig_remark)
@@ -428,71 +557,139 @@ std::string removeEmoji(const std::string &orig_remark)
     return remark;
 }
 
-std::string addEmoji(const Proxy &node, const RegexMatchConfigs &emoji_array, extra_settings &ext)
+void addEmoji(std::vector<Proxy> &nodes, const RegexMatchConfigs &emoji_array, extra_settings &ext)
 {
-    std::string real_rule, ret;
+    std::string real_rule;
+    string_array emojis;
+    std::vector<char> done(nodes.size(), 0);
+    size_t remaining = nodes.size();
 
     for(const RegexMatchConfig &x : emoji_array)
     {
+        if(!remaining)
+            break;
         if(!x.Script.empty() && ext.authorized)
         {
-            std::string result;
-            script_safe_runner(ext.js_runtime, ext.js_context, [&](qjs::Context &ctx)
+            ProxyRefs refs;
+            std::vector<size_t> indexes;
+            for(size_t i = 0; i < nodes.size(); i++)
             {
-                std::string script = x.Script;
-                if(startsWith(script, "path:"))
-                    script = fileGet(script.substr(5), true);
-                try
-                {
-                    ctx.eval(script);
-                    auto getEmoji = (std::function<std::string(const Proxy&)>) ctx.eval("getEmoji");
-                    ret = getEmoji(node);
-                    if(!ret.empty())
-                        result = ret + " " + node.Remark;
-                }
-                catch (qjs::exception)
-                {
-                    script_print_stack(ctx);
-                }
-            }, global.scriptCleanContext);
-            if(!result.empty())
-                return result;
+                if(done[i])
+                    continue;
+                refs.push_back(&nodes[i]);
+                indexes.push_back(i);
+            }
+            if(!runNodeScript(x.Script, "getEmoji", refs, emojis, ext))
+                continue;
+            for(size_t i = 0; i < indexes.size(); i++)
+            {
+                if(emojis[i].empty())
+                    continue;
+                Proxy &node = nodes[indexes[i]];
+                node.Remark = emojis[i] + " " + node.Remark;
+                done[indexes[i]] = 1;
+                remaining--;
+            }
             continue;
         }
         if(x.Replace.empty())
             continue;
-        if(applyMatcher(x.Match, real_rule, node) && real_rule.size() && regFind(node.Remark, real_rule))
-            return x.Replace + " " + node.Remark;
+        for(size_t i = 0; i < nodes.size(); i++)
+        {
+            Proxy &node = nodes[i];
+            if(done[i])
+                continue;
+            if(applyMatcher(x.Match, real_rule, node) && real_rule.size() && regFind(node.Remark, real_rule))
+            {
+                node.Remark = x.Replace + " " + node.Remark;
+                done[i] = 1;
+                remaining--;
+            }
+        }
+    }
+}
+
+/// Sort with a script that defines `sortKey(node)` instead of `compare(a, b)`:
+/// the key of every node is computed by one script call, then the nodes are
+/// sorted natively. Numbers order before strings, unknown nodes stay in front.
+static void sortNodesByKey(std::vector<Proxy> &nodes, qjs::Context &ctx)
+{
+    struct SortKey
+    {
+        int rank = 0;
+        double number = 0.0;
+        std::string text;
+    };
+    auto sort_key = (std::function<qjs::Value(const Proxy&)>) ctx.eval("sortKey");
+    std::vector<SortKey> keys(nodes.size());
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        if(nodes[i].Type == ProxyType::Unknown)
+            continue;
+        ScriptNodeScope scope(ctx);
+        qjs::Value key = sort_key(nodes[i]);
+        if(JS_IsNumber(key.v) && !std::isnan(key.as<double>()))
+        {
+            keys[i].rank = 1;
+            keys[i].number = key.as<double>();
+        }
+        else
+        {
+            keys[i].rank = 2;
+            keys[i].text = key.as<std::string>();
+        }
     }
-    return node.Remark;
+
+    std::vector<size_t> order(nodes.size());
+    for(size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b)
+    {
+        const SortKey &x = keys[a], &y = keys[b];
+        if(x.rank != y.rank)
+            return x.rank < y.rank;
+        if(x.rank == 1)
+            return x.number < y.number;
+        return x.text < y.text;
+    });
+    std::vector<Proxy> sorted;
+    sorted.reserve(nodes.size());
+    for(size_t i : order)
+        sorted.emplace_back(std::move(nodes[i]));
+    nodes.swap(sorted);
 }
 
 void preprocessNodes(std::vector<Proxy> &nodes, extra_settings &ext)
 {
-    std::for_each(nodes.begin(), nodes.end(), [&ext](Proxy &x)
+    if(ext.remove_emoji)
     {
-        if(ext.remove_emoji)
+        for(Proxy &x : nodes)
             x.Remark = trim(removeEmoji(x.Remark));
+    }
 
-        nodeRename(x, ext.rename_array, ext);
+    nodeRename(nodes, ext.rename_array, ext);
 
-        if(ext.add_emoji)
-            x.Remark = addEmoji(x, ext.emoji_array, ext);
-    });
+    if(ext.add_emoji)
+        addEmoji(nodes, ext.emoji_array, ext);
 
     if(ext.sort_flag)
     {
         bool failed = true;
         if(ext.sort_script.size() && ext.authorized)
         {
-            std::string script = ext.sort_script;
-            if(startsWith(script, "path:"))
-                script = fileGet(script.substr(5), false);
+            FileView script = startsWith(ext.sort_script, "path:") ? fileView(ext.sort_script.substr(5), false) : FileView(nullptr, ext.sort_script);
             script_safe_runner(ext.js_runtime, ext.js_context, [&](qjs::Context &ctx)
             {
                 try
                 {
-                    ctx.eval(script);
+                    ctx.eval("globalThis.sortKey = undefined");
+                    script_eval(ctx, script.view());
+                    if((std::string) ctx.eval("typeof sortKey") == "function")
+                    {
+                        sortNodesByKey(nodes, ctx);
+                        failed = false;
+                        return;
+                    }
                     auto compare = (std::function<int(const Proxy&, const Proxy&)>) ctx.eval("compare");
                     auto comparer = [&](const Proxy &a, const Proxy &b)
                     {
@@ -500,6 +697,7 @@ void preprocessNodes(std::vector<Proxy> &nodes, extra_settings &ext)
                             return 1;
                         if(b.Type == ProxyType::Unknown)
                             return 0;
+                        ScriptNodeScope scope(ctx);
                         return compare(a, b);
                     };
                     std::stable_sort(nodes.begin(), nodes.end(), comparer);
@@ -509,7 +707,7 @@ void preprocessNodes(std::vector<Proxy> &nodes, extra_settings &ext)
                 {
                     script_print_stack(ctx);
                 }
-            }, global.scriptCleanContext);
+            }, global.scriptCleanContext, "sort");
         }
         if(failed) std::stable_sort(nodes.begin(), nodes.end(), [](const Proxy &a, const Proxy &b)
         {
@@ -12,6 +12,7 @@
 #include "config/regmatch.h"
 #include "parser/config/proxy.h"
 #include "utils/map_extra.h"
+#include "utils/regexp.h"
 #include "utils/string.h"
 
 struct parse_settings
@@ -19,8 +20,8 @@ struct parse_settings
     std::string *proxy = nullptr;
     string_array *exclude_remarks = nullptr;
     string_array *include_remarks = nullptr;
-    RegexMatchConfigs *stream_rules = nullptr;
-    RegexMatchConfigs *time_rules = nullptr;
+    const RegexReplacers *stream_rules = nullptr;
+    const RegexReplacers *time_rules = nullptr;
     std::string *sub_info = nullptr;
     bool authorized = false;
     string_icase_map *request_header = nullptr;
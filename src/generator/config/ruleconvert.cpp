@@ -19,7 +19,7 @@ string_array QuanXRuleTypes = {basic_types, "USER-AGENT", "HOST", "HOST-SUFFIX",
 string_array SurfRuleTypes = {basic_types, "IP-CIDR6", "PROCESS-NAME", "IN-PORT", "DEST-PORT", "SRC-IP"};
 string_array SingBoxRuleTypes = {basic_types, "IP-VERSION", "INBOUND", "PROTOCOL", "NETWORK", "GEOSITE", "SRC-GEOIP", "DOMAIN-REGEX", "PROCESS-NAME", "PROCESS-PATH", "PACKAGE-NAME", "PORT", "PORT-RANGE", "SRC-PORT", "SRC-PORT-RANGE", "USER", "USER-ID"};
 
-std::string convertRuleset(const std::string &content, int type)
+std::string convertRuleset(std::string_view source, int type)
 {
     /// Target: Surge type,pattern[,flag]
     /// Source: QuanX type,pattern[,group]
@@ -28,7 +28,8 @@ std::string convertRuleset(const std::string &content, int type)
     std::string output, strLine;
 
     if(type == RULESET_SURGE)
-        return content;
+        return std::string(source);
+    const std::string content(source);
 
     if(regFind(content, "^payload:\\r?\\n")) /// Clash
     {
@@ -142,15 +143,15 @@ void rulesetToClash(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_
         if(global.maxAllowedRules && total_rules > global.maxAllowedRules)
             break;
         rule_group = x.rule_group;
-        retrieved_rules = x.rule_content.get();
-        if(retrieved_rules.empty())
+        const FileView &source = x.rule_content.get();
+        if(source.empty())
         {
             writeLog(0, "Failed to fetch ruleset or ruleset is empty: '" + x.rule_path + "'!", LOG_LEVEL_WARNING);
             continue;
         }
-        if(startsWith(retrieved_rules, "[]"))
+        if(source.view().substr(0, 2) == "[]")
         {
-            strLine = retrieved_rules.substr(2);
+            strLine = source.view().substr(2);
             if(startsWith(strLine, "FINAL"))
                 strLine.replace(0, 5, "MATCH");
             strLine = transformRuleToCommon(temp, strLine, rule_group);
@@ -158,7 +159,7 @@ void rulesetToClash(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_
             total_rules++;
             continue;
         }
-        retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
+        retrieved_rules = convertRuleset(source.view(), x.rule_type);
         char delimiter = getLineBreak(retrieved_rules);
 
         strStrm.clear();
@@ -213,15 +214,15 @@ std::string rulesetToClashStr(YAML::Node &base_rule, std::vector<RulesetContent>
         if(global.maxAllowedRules && total_rules > global.maxAllowedRules)
             break;
         rule_group = x.rule_group;
-        retrieved_rules = x.rule_content.get();
-        if(retrieved_rules.empty())
+        const FileView &source = x.rule_content.get();
+        if(source.empty())
         {
             writeLog(0, "Failed to fetch ruleset or ruleset is empty: '" + x.rule_path + "'!", LOG_LEVEL_WARNING);
             continue;
         }
-        if(startsWith(retrieved_rules, "[]"))
+        if(source.view().substr(0, 2) == "[]")
         {
-            strLine = retrieved_rules.substr(2);
+            strLine = source.view().substr(2);
             if(startsWith(strLine, "FINAL"))
                 strLine.replace(0, 5, "MATCH");
             strLine = transformRuleToCommon(temp, strLine, rule_group);
@@ -229,7 +230,7 @@ std::string rulesetToClashStr(YAML::Node &base_rule, std::vector<RulesetContent>
             total_rules++;
             continue;
         }
-        retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
+        retrieved_rules = convertRuleset(source.view(), x.rule_type);
         char delimiter = getLineBreak(retrieved_rules);
 
         strStrm.clear();
@@ -326,7 +327,7 @@ void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_c
         rule_path_typed = x.rule_path_typed;
         if(rule_path.empty())
         {
-            strLine = x.rule_content.get().substr(2);
+            strLine = x.rule_content.get().view().substr(2);
             if(strLine == "MATCH")
                 strLine = "FINAL";
             if(surge_ver == -1 || surge_ver == -2)
@@ -411,14 +412,14 @@ void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_c
             }
             else
                 continue;
-            retrieved_rules = x.rule_content.get();
-            if(retrieved_rules.empty())
+            const FileView &source = x.rule_content.get();
+            if(source.empty())
             {
                 writeLog(0, "Failed to fetch ruleset or ruleset is empty: '" + x.rule_path + "'!", LOG_LEVEL_WARNING);
                 continue;
             }
 
-            retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
+            retrieved_rules = convertRuleset(source.view(), x.rule_type);
             char delimiter = getLineBreak(retrieved_rules);
 
             strStrm.clear();
@@ -569,15 +570,15 @@ void rulesetToSingBox(rapidjson::Document &base_rule, std::vector<RulesetContent
         if(global.maxAllowedRules && total_rules > global.maxAllowedRules)
             break;
         rule_group = x.rule_group;
-        retrieved_rules = x.rule_content.get();
-        if(retrieved_rules.empty())
+        const FileView &source = x.rule_content.get();
+        if(source.empty())
         {
             writeLog(0, "Failed to fetch ruleset or ruleset is empty: '" + x.rule_path + "'!", LOG_LEVEL_WARNING);
             continue;
         }
-        if(startsWith(retrieved_rules, "[]"))
+        if(source.view().substr(0, 2) == "[]")
         {
-            strLine = retrieved_rules.substr(2);
+            strLine = source.view().substr(2);
             if(startsWith(strLine, "FINAL") || startsWith(strLine, "MATCH"))
             {
                 final = rule_group;
@@ -587,7 +588,7 @@ void rulesetToSingBox(rapidjson::Document &base_rule, std::vector<RulesetContent
             total_rules++;
             continue;
         }
-        retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
+        retrieved_rules = convertRuleset(source.view(), x.rule_type);
         char delimiter = getLineBreak(retrieved_rules);
 
         strStrm.clear();
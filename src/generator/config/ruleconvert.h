@@ -2,12 +2,14 @@
 #define RULECONVERT_H_INCLUDED
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <future>
 
 #include <yaml-cpp/yaml.h>
 #include <rapidjson/document.h>
 
+#include "utils/file.h"
 #include "utils/ini_reader/ini_reader.h"
 
 enum ruleset_type
@@ -26,11 +28,11 @@ struct RulesetContent
     std::string rule_path_typed;
     std::string rule_format;
     int rule_type = RULESET_SURGE;
-    std::shared_future<std::string> rule_content;
+    std::shared_future<FileView> rule_content;
     int update_interval = 0;
 };
 
-std::string convertRuleset(const std::string &content, int type);
+std::string convertRuleset(std::string_view content, int type);
 void rulesetToClash(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_content_array, bool overwrite_original_rules, bool new_field_name);
 std::string rulesetToClashStr(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_content_array, bool overwrite_original_rules, bool new_field_name);
 void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_content_array, int surge_ver, bool overwrite_original_rules, const std::string& remote_path_prefix);
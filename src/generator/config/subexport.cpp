@@ -3,10 +3,14 @@
 #include <numeric>
 #include <cmath>
 #include <climits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "config/regmatch.h"
 #include "generator/config/subexport.h"
 #include "generator/template/templates.h"
+#include "handler/multithread.h"
 #include "handler/settings.h"
 #include "parser/config/proxy.h"
 #include "script/script_quickjs.h"
@@ -37,6 +41,51 @@ const string_array clash_ssr_ciphers = {
     "rc4-md5", "aes-128-ctr", "aes-192-ctr", "aes-256-ctr", "aes-128-cfb",
     "aes-192-cfb", "aes-256-cfb", "chacha20-ietf", "xchacha20", "none"
 };
+/// Parsed base configurations keyed by their text. Entries are never modified,
+/// every request works on its own copy instead of parsing the same base again.
+template<typename T>
+class BaseConfigCache {
+public:
+    std::shared_ptr<const T> find(const std::string &content) {
+        guarded_mutex guard(mutex_);
+        auto iter = entries_.find(std::hash<std::string>()(content));
+        if (iter == entries_.end() || iter->second.content != content)
+            return nullptr;
+        return iter->second.parsed;
+    }
+
+    void put(const std::string &content, std::shared_ptr<const T> parsed) {
+        guarded_mutex guard(mutex_);
+        if (entries_.size() >= max_entries)
+            entries_.clear();
+        entries_[std::hash<std::string>()(content)] = Entry{content, std::move(parsed)};
+    }
+
+private:
+    struct Entry {
+        std::string content;
+        std::shared_ptr<const T> parsed;
+    };
+
+    static constexpr size_t max_entries = 16;
+    std::mutex mutex_;
+    std::unordered_map<size_t, Entry> entries_;
+};
+
+/// load an INI base into ini, setup() applies the parser options of the target
+static int loadIniBase(BaseConfigCache<INIReader> &cache, const std::string &base_conf, INIReader &ini,
+                       void (*setup)(INIReader &)) {
+    setup(ini);
+    if (auto parsed = cache.find(base_conf)) {
+        ini = *parsed;
+        return INIREADER_EXCEPTION_NONE;
+    }
+    int result = ini.parse(base_conf);
+    if (result == INIREADER_EXCEPTION_NONE)
+        cache.put(base_conf, std::make_shared<const INIReader>(ini));
+    return result;
+}
+
 bool isNumeric(const std::string &str) {
     for (char c: str) {
         if (!std::isdigit(static_cast<unsigned char>(c))) {
@@ -219,7 +268,7 @@ void processRemark(std::string &remark, const string_array &remarks_list, bool p
 }
 
 void
-groupGenerate(const std::string &rule, std::vector<Proxy> &nodelist, string_array &filtered_nodelist, bool add_direct,
+groupGenerate(const std::string &rule, const ProxyRefs &nodelist, string_array &filtered_nodelist, bool add_direct,
               extra_settings &ext) {
     std::string real_rule;
     if (startsWith(rule, "[]") && add_direct) {
@@ -228,23 +277,35 @@ groupGenerate(const std::string &rule, std::vector<Proxy> &nodelist, string_arra
 #ifndef NO_JS_RUNTIME
     else if (startsWith(rule, "script:") && ext.authorized) {
         script_safe_runner(ext.js_runtime, ext.js_context, [&](qjs::Context &ctx) {
-            std::string script = fileGet(rule.substr(7), true);
             try {
-                ctx.eval(script);
-                auto filter = (std::function<std::string(const std::vector<Proxy> &)>) ctx.eval("filter");
-                std::string result_list = filter(nodelist);
+                std::function<std::string(const ProxyRefs &)> filter;
+                auto iter = ext.js_group_filters.find(rule);
+                if (iter != ext.js_group_filters.end())
+                    filter = iter->second;
+                else {
+                    script_eval(ctx, fileView(rule.substr(7), true).view());
+                    filter = (std::function<std::string(const ProxyRefs &)>) ctx.eval("filter");
+                    /// a clean context is discarded after this call, so only the shared one can be reused
+                    if (!global.scriptCleanContext)
+                        ext.js_group_filters.emplace(rule, filter);
+                }
+                std::string result_list;
+                {
+                    ScriptNodeScope scope(ctx);
+                    result_list = filter(nodelist);
+                }
                 filtered_nodelist = split(regTrim(result_list), "\n");
             } catch (qjs::exception) {
                 script_print_stack(ctx);
             }
-        }, global.scriptCleanContext);
+        }, global.scriptCleanContext, "group");
     }
 #endif // NO_JS_RUNTIME
     else {
-        for (Proxy &x: nodelist) {
-            if (applyMatcher(rule, real_rule, x) && (real_rule.empty() || regFind(x.Remark, real_rule)) &&
-                std::find(filtered_nodelist.begin(), filtered_nodelist.end(), x.Remark) == filtered_nodelist.end())
-                filtered_nodelist.emplace_back(x.Remark);
+        for (const Proxy *x: nodelist) {
+            if (applyMatcher(rule, real_rule, *x) && (real_rule.empty() || regFind(x->Remark, real_rule)) &&
+                std::find(filtered_nodelist.begin(), filtered_nodelist.end(), x->Remark) == filtered_nodelist.end())
+                filtered_nodelist.emplace_back(x->Remark);
         }
     }
 }
@@ -253,7 +314,7 @@ void
 proxyToClash(std::vector<Proxy> &nodes, YAML::Node &yamlnode, const ProxyGroupConfigs &extra_proxy_group, bool clashR,
              extra_settings &ext) {
     YAML::Node proxies, original_groups;
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
     string_array remarks_list;
     /// proxies style
 
@@ -315,21 +376,25 @@ proxyToClash(std::vector<Proxy> &nodes, YAML::Node &yamlnode, const ProxyGroupCo
                     singleproxy["password"].SetTag("str");
                 switch (hash_(x.Plugin)) {
                     case "simple-obfs"_hash:
-                    case "obfs-local"_hash:
+                    case "obfs-local"_hash: {
+                        UrlArgs plugin_args(pluginopts);
                         singleproxy["plugin"] = "obfs";
-                        singleproxy["plugin-opts"]["mode"] = urlDecode(getUrlArg(pluginopts, "obfs"));
-                        singleproxy["plugin-opts"]["host"] = urlDecode(getUrlArg(pluginopts, "obfs-host"));
+                        singleproxy["plugin-opts"]["mode"] = urlDecode(plugin_args.get("obfs"));
+                        singleproxy["plugin-opts"]["host"] = urlDecode(plugin_args.get("obfs-host"));
                         break;
-                    case "v2ray-plugin"_hash:
+                    }
+                    case "v2ray-plugin"_hash: {
+                        UrlArgs plugin_args(pluginopts);
                         singleproxy["plugin"] = "v2ray-plugin";
-                        singleproxy["plugin-opts"]["mode"] = getUrlArg(pluginopts, "mode");
-                        singleproxy["plugin-opts"]["host"] = getUrlArg(pluginopts, "host");
-                        singleproxy["plugin-opts"]["path"] = getUrlArg(pluginopts, "path");
+                        singleproxy["plugin-opts"]["mode"] = plugin_args.get("mode");
+                        singleproxy["plugin-opts"]["host"] = plugin_args.get("host");
+                        singleproxy["plugin-opts"]["path"] = plugin_args.get("path");
                         singleproxy["plugin-opts"]["tls"] = pluginopts.find("tls") != std::string::npos;
                         singleproxy["plugin-opts"]["mux"] = pluginopts.find("mux") != std::string::npos;
                         if (!scv.is_undef())
                             singleproxy["plugin-opts"]["skip-cert-verify"] = scv.get();
                         break;
+                    }
                 }
                 break;
             case ProxyType::VMess:
@@ -751,7 +816,7 @@ proxyToClash(std::vector<Proxy> &nodes, YAML::Node &yamlnode, const ProxyGroupCo
             singleproxy.SetStyle(YAML::EmitterStyle::Flow);
         proxies.push_back(singleproxy);
         remarks_list.emplace_back(x.Remark);
-        nodelist.emplace_back(x);
+        nodelist.emplace_back(&x);
     }
 
     if (proxy_compact)
@@ -877,13 +942,19 @@ std::string proxyToClash(std::vector<Proxy> &nodes, const std::string &base_conf
                          std::vector<RulesetContent> &ruleset_content_array,
                          const ProxyGroupConfigs &extra_proxy_group,
                          bool clashR, extra_settings &ext) {
+    static BaseConfigCache<YAML::Node> bases;
     YAML::Node yamlnode;
 
-    try {
-        yamlnode = YAML::Load(base_conf);
-    } catch (std::exception &e) {
-        writeLog(0, std::string("Clash base loader failed with error: ") + e.what(), LOG_LEVEL_ERROR);
-        return "";
+    if (auto parsed = bases.find(base_conf)) {
+        yamlnode = YAML::Clone(*parsed);
+    } else {
+        try {
+            yamlnode = YAML::Load(base_conf);
+        } catch (std::exception &e) {
+            writeLog(0, std::string("Clash base loader failed with error: ") + e.what(), LOG_LEVEL_ERROR);
+            return "";
+        }
+        bases.put(base_conf, std::make_shared<const YAML::Node>(YAML::Clone(yamlnode)));
     }
 
     proxyToClash(nodes, yamlnode, extra_proxy_group, clashR, ext);
@@ -951,23 +1022,26 @@ std::string proxyToSurge(std::vector<Proxy> &nodes, const std::string &base_conf
                          std::vector<RulesetContent> &ruleset_content_array,
                          const ProxyGroupConfigs &extra_proxy_group,
                          int surge_ver, extra_settings &ext) {
+    static BaseConfigCache<INIReader> bases;
     INIReader ini;
     std::string output_nodelist;
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
     unsigned short local_port = 1080;
     string_array remarks_list;
 
-    ini.store_any_line = true;
-    // filter out sections that requires direct-save
-    ini.add_direct_save_section("General");
-    ini.add_direct_save_section("Replica");
-    ini.add_direct_save_section("Rule");
-    ini.add_direct_save_section("MITM");
-    ini.add_direct_save_section("Script");
-    ini.add_direct_save_section("Host");
-    ini.add_direct_save_section("URL Rewrite");
-    ini.add_direct_save_section("Header Rewrite");
-    if (ini.parse(base_conf) != 0 && !ext.nodelist) {
+    auto setup = [](INIReader &base) {
+        base.store_any_line = true;
+        // filter out sections that requires direct-save
+        base.add_direct_save_section("General");
+        base.add_direct_save_section("Replica");
+        base.add_direct_save_section("Rule");
+        base.add_direct_save_section("MITM");
+        base.add_direct_save_section("Script");
+        base.add_direct_save_section("Host");
+        base.add_direct_save_section("URL Rewrite");
+        base.add_direct_save_section("Header Rewrite");
+    };
+    if (loadIniBase(bases, base_conf, ini, setup) != 0 && !ext.nodelist) {
         writeLog(0, "Surge base loader failed with error: " + ini.get_last_error(), LOG_LEVEL_ERROR);
         return "";
     }
@@ -1204,7 +1278,7 @@ std::string proxyToSurge(std::vector<Proxy> &nodes, const std::string &base_conf
             output_nodelist += x.Remark + " = " + proxy + "\n";
         else {
             ini.set("{NONAME}", x.Remark + " = " + proxy);
-            nodelist.emplace_back(x);
+            nodelist.emplace_back(&x);
         }
         remarks_list.emplace_back(x.Remark);
     }
@@ -1515,9 +1589,13 @@ std::string
 proxyToQuan(std::vector<Proxy> &nodes, const std::string &base_conf,
             std::vector<RulesetContent> &ruleset_content_array,
             const ProxyGroupConfigs &extra_proxy_group, extra_settings &ext) {
+    static BaseConfigCache<INIReader> bases;
     INIReader ini;
-    ini.store_any_line = true;
-    if (!ext.nodelist && ini.parse(base_conf) != 0) {
+    auto setup = [](INIReader &base) { base.store_any_line = true; };
+    //loadIniBase() sets the parser up itself, a node list has no base to load
+    if (ext.nodelist)
+        setup(ini);
+    else if (loadIniBase(bases, base_conf, ini, setup) != 0) {
         writeLog(0, "Quantumult base loader failed with error: " + ini.get_last_error(), LOG_LEVEL_ERROR);
         return "";
     }
@@ -1538,7 +1616,7 @@ proxyToQuan(std::vector<Proxy> &nodes, const std::string &base_conf,
 void proxyToQuan(std::vector<Proxy> &nodes, INIReader &ini, std::vector<RulesetContent> &ruleset_content_array,
                  const ProxyGroupConfigs &extra_proxy_group, extra_settings &ext) {
     std::string proxyStr;
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
     string_array remarks_list;
 
     ini.set_current_section("SERVER");
@@ -1671,7 +1749,7 @@ void proxyToQuan(std::vector<Proxy> &nodes, INIReader &ini, std::vector<RulesetC
 
         ini.set("{NONAME}", proxyStr);
         remarks_list.emplace_back(x.Remark);
-        nodelist.emplace_back(x);
+        nodelist.emplace_back(&x);
     }
 
     if (ext.nodelist)
@@ -1743,16 +1821,22 @@ std::string proxyToQuanX(std::vector<Proxy> &nodes, const std::string &base_conf
                          std::vector<RulesetContent> &ruleset_content_array,
                          const ProxyGroupConfigs &extra_proxy_group,
                          extra_settings &ext) {
+    static BaseConfigCache<INIReader> bases;
     INIReader ini;
-    ini.store_any_line = true;
-    ini.add_direct_save_section("general");
-    ini.add_direct_save_section("dns");
-    ini.add_direct_save_section("rewrite_remote");
-    ini.add_direct_save_section("rewrite_local");
-    ini.add_direct_save_section("task_local");
-    ini.add_direct_save_section("mitm");
-    ini.add_direct_save_section("server_remote");
-    if (!ext.nodelist && ini.parse(base_conf) != 0) {
+    auto setup = [](INIReader &base) {
+        base.store_any_line = true;
+        base.add_direct_save_section("general");
+        base.add_direct_save_section("dns");
+        base.add_direct_save_section("rewrite_remote");
+        base.add_direct_save_section("rewrite_local");
+        base.add_direct_save_section("task_local");
+        base.add_direct_save_section("mitm");
+        base.add_direct_save_section("server_remote");
+    };
+    //loadIniBase() sets the parser up itself, a node list has no base to load
+    if (ext.nodelist)
+        setup(ini);
+    else if (loadIniBase(bases, base_conf, ini, setup) != 0) {
         writeLog(0, "QuantumultX base loader failed with error: " + ini.get_last_error(), LOG_LEVEL_ERROR);
         return "";
     }
@@ -1774,7 +1858,7 @@ void proxyToQuanX(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Ruleset
                   const ProxyGroupConfigs &extra_proxy_group, extra_settings &ext) {
     std::string proxyStr;
     tribool udp, tfo, scv, tls13;
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
     string_array remarks_list;
 
     ini.set_current_section("server_local");
@@ -1882,11 +1966,12 @@ void proxyToQuanX(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Ruleset
                             if (!pluginopts.empty())
                                 proxyStr += ", " + replaceAllDistinct(pluginopts, ";", ", ");
                             break;
-                        case "v2ray-plugin"_hash:
+                        case "v2ray-plugin"_hash: {
                             pluginopts = replaceAllDistinct(pluginopts, ";", "&");
-                            plugin = getUrlArg(pluginopts, "mode") == "websocket" ? "ws" : "";
-                            host = getUrlArg(pluginopts, "host");
-                            path = getUrlArg(pluginopts, "path");
+                            UrlArgs plugin_args(pluginopts);
+                            plugin = plugin_args.get("mode") == "websocket" ? "ws" : "";
+                            host = plugin_args.get("host");
+                            path = plugin_args.get("path");
                             tlssecure = pluginopts.find("tls") != std::string::npos;
                             if (tlssecure && plugin == "ws") {
                                 plugin += 's';
@@ -1899,6 +1984,7 @@ void proxyToQuanX(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Ruleset
                             if (!path.empty())
                                 proxyStr += ", obfs-uri=" + path;
                             break;
+                        }
                         default:
                             continue;
                     }
@@ -1965,7 +2051,7 @@ void proxyToQuanX(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Ruleset
 
         ini.set("{NONAME}", proxyStr);
         remarks_list.emplace_back(x.Remark);
-        nodelist.emplace_back(x);
+        nodelist.emplace_back(&x);
     }
 
     if (ext.nodelist)
@@ -2146,9 +2232,9 @@ std::string proxyToSSD(std::vector<Proxy> &nodes, std::string &group, std::strin
 std::string proxyToMellow(std::vector<Proxy> &nodes, const std::string &base_conf,
                           std::vector<RulesetContent> &ruleset_content_array,
                           const ProxyGroupConfigs &extra_proxy_group, extra_settings &ext) {
+    static BaseConfigCache<INIReader> bases;
     INIReader ini;
-    ini.store_any_line = true;
-    if (ini.parse(base_conf) != 0) {
+    if (loadIniBase(bases, base_conf, ini, [](INIReader &base) { base.store_any_line = true; }) != 0) {
         writeLog(0, "Mellow base loader failed with error: " + ini.get_last_error(), LOG_LEVEL_ERROR);
         return "";
     }
@@ -2166,7 +2252,7 @@ void proxyToMellow(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Rulese
     std::string id, aid, transproto, faketype, host, path, quicsecure, quicsecret, tlssecure;
     std::string url;
     tribool tfo, scv;
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
     string_array vArray, remarks_list;
 
     ini.set_current_section("Endpoint");
@@ -2241,7 +2327,7 @@ void proxyToMellow(std::vector<Proxy> &nodes, INIReader &ini, std::vector<Rulese
 
         ini.set("{NONAME}", proxy);
         remarks_list.emplace_back(x.Remark);
-        nodelist.emplace_back(x);
+        nodelist.emplace_back(&x);
     }
 
     ini.set_current_section("EndpointGroup");
@@ -2300,15 +2386,18 @@ std::string
 proxyToLoon(std::vector<Proxy> &nodes, const std::string &base_conf,
             std::vector<RulesetContent> &ruleset_content_array,
             const ProxyGroupConfigs &extra_proxy_group, extra_settings &ext) {
+    static BaseConfigCache<INIReader> bases;
     INIReader ini;
     std::string output_nodelist;
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
 
     string_array remarks_list;
 
-    ini.store_any_line = true;
-    ini.add_direct_save_section("Plugin");
-    if (ini.parse(base_conf) != INIREADER_EXCEPTION_NONE && !ext.nodelist) {
+    auto setup = [](INIReader &base) {
+        base.store_any_line = true;
+        base.add_direct_save_section("Plugin");
+    };
+    if (loadIniBase(bases, base_conf, ini, setup) != INIREADER_EXCEPTION_NONE && !ext.nodelist) {
         writeLog(0, "Loon base loader failed with error: " + ini.get_last_error(), LOG_LEVEL_ERROR);
         return "";
     }
@@ -2509,7 +2598,7 @@ proxyToLoon(std::vector<Proxy> &nodes, const std::string &base_conf,
             output_nodelist += x.Remark + " = " + proxy + "\n";
         else {
             ini.set("{NONAME}", x.Remark + " = " + proxy);
-            nodelist.emplace_back(x);
+            nodelist.emplace_back(&x);
             remarks_list.emplace_back(x.Remark);
         }
     }
@@ -2686,7 +2775,7 @@ proxyToSingBox(std::vector<Proxy> &nodes, rapidjson::Document &json,
     using namespace rapidjson_ext;
     rapidjson::Document::AllocatorType &allocator = json.GetAllocator();
     rapidjson::Value outbounds(rapidjson::kArrayType), route(rapidjson::kArrayType);
-    std::vector<Proxy> nodelist;
+    ProxyRefs nodelist;
     string_array remarks_list;
     std::string search = " Mbps";
 
@@ -3056,7 +3145,7 @@ proxyToSingBox(std::vector<Proxy> &nodes, rapidjson::Document &json,
         if (!tfo.is_undef()) {
             proxy.AddMember("tcp_fast_open", buildBooleanValue(tfo), allocator);
         }
-        nodelist.push_back(x);
+        nodelist.push_back(&x);
         remarks_list.emplace_back(x.Remark);
         outbounds.PushBack(proxy, allocator);
     }
@@ -3129,14 +3218,22 @@ std::string proxyToSingBox(std::vector<Proxy> &nodes, const std::string &base_co
                            std::vector<RulesetContent> &ruleset_content_array,
                            const ProxyGroupConfigs &extra_proxy_group, extra_settings &ext) {
     using namespace rapidjson_ext;
+    static BaseConfigCache<rapidjson::Document> bases;
     rapidjson::Document json;
 
     if (!ext.nodelist) {
-        json.Parse(base_conf.data());
-        if (json.HasParseError()) {
-            writeLog(0, "sing-box base loader failed with error: " +
-                        std::string(rapidjson::GetParseError_En(json.GetParseError())), LOG_LEVEL_ERROR);
-            return "";
+        if (auto parsed = bases.find(base_conf)) {
+            json.CopyFrom(*parsed, json.GetAllocator());
+        } else {
+            json.Parse(base_conf.data());
+            if (json.HasParseError()) {
+                writeLog(0, "sing-box base loader failed with error: " +
+                            std::string(rapidjson::GetParseError_En(json.GetParseError())), LOG_LEVEL_ERROR);
+                return "";
+            }
+            auto copy = std::make_shared<rapidjson::Document>();
+            copy->CopyFrom(json, copy->GetAllocator());
+            bases.put(base_conf, std::move(copy));
         }
     } else {
         json.SetObject();
@@ -1,10 +1,12 @@
 #ifndef SUBEXPORT_H_INCLUDED
 #define SUBEXPORT_H_INCLUDED
 
+#include <functional>
+#include <map>
 #include <string>
 
 #ifndef NO_JS_RUNTIME
-#include <quickjspp.hpp>
+#include "script/script_quickjs.h"
 #endif // NO_JS_RUNTIME
 
 #include "config/proxygroup.h"
@@ -15,7 +17,8 @@
 #include "utils/yamlcpp_extra.h"
 #include "ruleconvert.h"
 
-struct extra_settings
+/// the plain, copyable generator options of a request
+struct export_options
 {
     bool enable_rule_generator = true;
     bool overwrite_original_rules = true;
@@ -42,7 +45,11 @@ struct extra_settings
     std::string clash_proxies_style = "flow";
     std::string clash_proxy_groups_style = "flow";
     bool authorized = false;
+};
 
+/// generator options plus the script state of a request, which is never copied
+struct extra_settings : export_options
+{
     extra_settings() = default;
     extra_settings(const extra_settings&) = delete;
     extra_settings(extra_settings&&) = delete;
@@ -50,12 +57,9 @@ struct extra_settings
 #ifndef NO_JS_RUNTIME
     qjs::Runtime *js_runtime = nullptr;
     qjs::Context *js_context = nullptr;
-
-    ~extra_settings()
-    {
-        delete js_context;
-        delete js_runtime;
-    }
+    ScriptContextLease js_lease;
+    /// group filters already resolved in js_context, keyed by their "script:" rule
+    std::map<std::string, std::function<std::string(const ProxyRefs &)>> js_group_filters;
 #endif // NO_JS_RUNTIME
 };
 
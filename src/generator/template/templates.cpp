@@ -331,7 +331,7 @@ int renderClashScript(YAML::Node &base_rule, std::vector<RulesetContent> &rulese
         rule_path_typed = x.rule_path_typed;
         if(rule_path.empty())
         {
-            strLine = x.rule_content.get().substr(2);
+            strLine = x.rule_content.get().view().substr(2);
             if(script)
             {
                 if(startsWith(strLine, "MATCH") || startsWith(strLine, "FINAL"))
@@ -409,14 +409,14 @@ int renderClashScript(YAML::Node &base_rule, std::vector<RulesetContent> &rulese
                     continue;
             }
 
-            retrieved_rules = x.rule_content.get();
-            if(retrieved_rules.empty())
+            const FileView &source = x.rule_content.get();
+            if(source.empty())
             {
                 writeLog(0, "Failed to fetch ruleset or ruleset is empty: '" + x.rule_path + "'!", LOG_LEVEL_WARNING);
                 continue;
             }
 
-            retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
+            retrieved_rules = convertRuleset(source.view(), x.rule_type);
             char delimiter = getLineBreak(retrieved_rules);
 
             strStrm.clear();
@@ -1,5 +1,8 @@
 #include <iostream>
 #include <string>
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <mutex>
 #include <numeric>
 
@@ -161,8 +164,7 @@ std::string getRuleset(RESPONSE_CALLBACK_ARGS) {
     RulesetConfigs confs = INIBinding::from<RulesetConfig>::from_ini(vArray);
     refreshRulesets(confs, rca);
     for (RulesetContent &x: rca) {
-        std::string content = x.rule_content.get();
-        output_content += convertRuleset(content, x.rule_type);
+        output_content += convertRuleset(x.rule_content.get().view(), x.rule_type);
     }
 
     if (output_content.empty()) {
@@ -296,6 +298,81 @@ void checkExternalBase(const std::string &path, std::string &dest) {
         dest = path;
 }
 
+/// Generate several targets from the same processed nodes in parallel and return them as one
+/// multipart/mixed response, one part per target. Every target works on its own copy of the
+/// nodes, rulesets and options, so generators that edit them in place do not see each other.
+template<typename SetOptions, typename Generate>
+static std::string generateBatch(const string_array &targets, const std::string &filename,
+                                 const std::vector<Proxy> &nodes, const std::vector<RulesetContent> &ruleset_content,
+                                 const template_args &tpl_args, const extra_settings &ext,
+                                 SetOptions &setTargetOptions, Generate &generate, Response &response) {
+    struct Artifact {
+        std::string target;
+        std::string content;
+        string_icase_map headers;
+        int status = 200;
+    };
+
+    std::vector<std::future<Artifact>> pending;
+    for (const std::string &target: targets) {
+        pending.emplace_back(std::async(std::launch::async, [&, target]() {
+            Artifact artifact;
+            artifact.target = target;
+            std::vector<Proxy> target_nodes = nodes;
+            std::vector<RulesetContent> target_rulesets = ruleset_content;
+            template_args target_args = tpl_args;
+            target_args.request_params["target"] = target;
+            extra_settings target_ext;
+            /// script contexts are never shared, only the plain options are copied
+            static_cast<export_options &>(target_ext) = ext;
+            setTargetOptions(target, target_ext);
+            if (target_ext.authorized && !global.scriptCleanContext) {
+                target_ext.js_lease = script_context_acquire();
+                target_ext.js_runtime = target_ext.js_lease.runtime();
+                target_ext.js_context = target_ext.js_lease.context();
+            }
+            artifact.content = generate(target, target_nodes, target_rulesets, target_args, target_ext,
+                                        artifact.headers, artifact.status);
+            return artifact;
+        }));
+    }
+    std::vector<Artifact> artifacts;
+    for (auto &x: pending)
+        artifacts.emplace_back(x.get());
+
+    for (Artifact &x: artifacts) {
+        if (x.status != 200) {
+            response.status_code = x.status;
+            return x.target + ": " + x.content;
+        }
+    }
+
+    std::string boundary;
+    for (unsigned int index = 0;; index++) {
+        boundary = "subconverter-batch-" + std::to_string(index);
+        if (std::none_of(artifacts.cbegin(), artifacts.cend(), [&](const Artifact &x) {
+            return x.content.find(boundary) != std::string::npos;
+        }))
+            break;
+    }
+
+    std::string output_content;
+    for (Artifact &x: artifacts) {
+        std::string name = filename.empty() ? x.target : x.target + "_" + filename;
+        output_content += "--" + boundary + "\r\n";
+        output_content += "Content-Type: text/plain; charset=utf-8\r\n";
+        output_content += "Content-Disposition: attachment; filename=\"" + name + "\"; filename*=utf-8''" +
+                          urlEncode(name) + "\r\n";
+        for (auto &header: x.headers)
+            output_content += header.first + ": " + header.second + "\r\n";
+        output_content += "\r\n" + x.content + "\r\n";
+    }
+    output_content += "--" + boundary + "--\r\n";
+    response.content_type = "multipart/mixed; boundary=" + boundary;
+    writeLog(0, "Generate completed for " + std::to_string(artifacts.size()) + " targets.", LOG_LEVEL_INFO);
+    return output_content;
+}
+
 std::string subconverter(RESPONSE_CALLBACK_ARGS) {
     auto &argument = request.argument;
     int *status_code = &response.status_code;
@@ -306,31 +383,48 @@ std::string subconverter(RESPONSE_CALLBACK_ARGS) {
     if (argTarget == "auto")
         matchUserAgent(request.headers["User-Agent"], argTarget, argClashNewField, intSurgeVer);
 
+    /// several comma-separated targets are generated from the same nodes in one request
+    string_array argTargets;
+    for (std::string &x: split(argTarget, ",")) {
+        if (!x.empty() && std::find(argTargets.cbegin(), argTargets.cend(), x) == argTargets.cend())
+            argTargets.emplace_back(std::move(x));
+    }
+    bool lBatch = argTargets.size() > 1;
+    if (argTargets.empty()) {
+        *status_code = 400;
+        return "Invalid target!";
+    }
+    /// a list that names one target, e.g. "clash,clash" or "clash,", is no batch
+    if (!lBatch)
+        argTarget = argTargets.front();
+
     /// don't try to load groups or rulesets when generating simple subscriptions
-    bool lSimpleSubscription = false;
-    switch (hash_(argTarget)) {
-        case "ss"_hash:
-        case "ssd"_hash:
-        case "ssr"_hash:
-        case "sssub"_hash:
-        case "v2ray"_hash:
-        case "trojan"_hash:
-        case "mixed"_hash:
-            lSimpleSubscription = true;
-            break;
-        case "clash"_hash:
-        case "clashr"_hash:
-        case "surge"_hash:
-        case "quan"_hash:
-        case "quanx"_hash:
-        case "loon"_hash:
-        case "surfboard"_hash:
-        case "mellow"_hash:
-        case "singbox"_hash:
-            break;
-        default:
-            *status_code = 400;
-            return "Invalid target!";
+    bool lSimpleSubscription = true;
+    for (const std::string &x: argTargets) {
+        switch (hash_(x)) {
+            case "ss"_hash:
+            case "ssd"_hash:
+            case "ssr"_hash:
+            case "sssub"_hash:
+            case "v2ray"_hash:
+            case "trojan"_hash:
+            case "mixed"_hash:
+                break;
+            case "clash"_hash:
+            case "clashr"_hash:
+            case "surge"_hash:
+            case "quan"_hash:
+            case "quanx"_hash:
+            case "loon"_hash:
+            case "surfboard"_hash:
+            case "mellow"_hash:
+            case "singbox"_hash:
+                lSimpleSubscription = false;
+                break;
+            default:
+                *status_code = 400;
+                return "Invalid target!";
+        }
     }
     //check if we need to read configuration
     if (global.reloadConfOnRequest && (!global.APIMode || global.CFWChildProcess) && !global.generatorMode)
@@ -362,7 +456,6 @@ std::string subconverter(RESPONSE_CALLBACK_ARGS) {
         "classic"), argTLS13 = getUrlArg(
         argument, "tls13");
 
-    std::string base_content, output_content;
     ProxyGroupConfigs lCustomProxyGroups = global.customProxyGroups;
     RulesetConfigs lCustomRulesets = global.customRulesets;
     string_array lIncludeRemarks = global.includeRemarks, lExcludeRemarks = global.excludeRemarks;
@@ -432,8 +525,6 @@ std::string subconverter(RESPONSE_CALLBACK_ARGS) {
     /// check other flags
     ext.authorized = authorized;
     ext.append_proxy_type = argAppendType.get(global.appendType);
-    if ((argTarget == "clash" || argTarget == "clashr") && argGenClashScript.is_undef())
-        argExpandRulesets.define(true);
 
     ext.clash_proxies_style = global.clashProxiesStyle;
     ext.clash_proxy_groups_style = global.clashProxyGroupsStyle;
@@ -449,21 +540,28 @@ std::string subconverter(RESPONSE_CALLBACK_ARGS) {
     if (ext.sort_flag && argUseSortScript)
         ext.sort_script = global.sortScript;
     ext.filter_deprecated = argFilterDeprecated.get(global.filterDeprecated);
-    ext.clash_new_field_name = argClashNewField.get(global.clashUseNewField);
-    ext.clash_script = argGenClashScript.get();
     ext.clash_classical_ruleset = argGenClassicalRuleProvider.get();
-    if (!argExpandRulesets)
-        ext.clash_new_field_name = true;
-    else
-        ext.clash_script = false;
+
+    /// options depending on the generated target, applied again to each target of a batch
+    auto setTargetOptions = [&](const std::string &target, extra_settings &ext) {
+        tribool expand = argExpandRulesets;
+        if ((target == "clash" || target == "clashr") && argGenClashScript.is_undef())
+            expand.define(true);
+        ext.clash_new_field_name = argClashNewField.get(global.clashUseNewField);
+        ext.clash_script = argGenClashScript.get();
+        if (!expand)
+            ext.clash_new_field_name = true;
+        else
+            ext.clash_script = false;
+        ext.managed_config_prefix = !expand ? global.managedConfigPrefix : "";
+    };
+    setTargetOptions(argTarget, ext);
 
     ext.nodelist = argGenNodeList;
     ext.surge_ssr_path = global.surgeSSRPath;
     ext.quanx_dev_id = !argDeviceID.empty() ? argDeviceID : global.quanXDevID;
     ext.enable_rule_generator = global.enableRuleGen;
     ext.overwrite_original_rules = global.overwriteOriginalRules;
-    if (!argExpandRulesets)
-        ext.managed_config_prefix = global.managedConfigPrefix;
 
     /// load external configuration
     if (argExternalConfig.empty())
@@ -551,14 +649,13 @@ std::string subconverter(RESPONSE_CALLBACK_ARGS) {
 
     /// initialize script runtime
     if (authorized && !global.scriptCleanContext) {
-        ext.js_runtime = new qjs::Runtime();
-        script_runtime_init(*ext.js_runtime);
-        ext.js_context = new qjs::Context(*ext.js_runtime);
-        script_context_init(*ext.js_context);
+        ext.js_lease = script_context_acquire();
+        ext.js_runtime = ext.js_lease.runtime();
+        ext.js_context = ext.js_lease.context();
     }
 
     //start parsing urls
-    RegexMatchConfigs stream_temp = safe_get_streams(), time_temp = safe_get_times();
+    auto stream_temp = safe_get_streams(), time_temp = safe_get_times();
 
     //loading urls
     string_array urls;
@@ -569,8 +666,8 @@ std::string subconverter(RESPONSE_CALLBACK_ARGS) {
     parse_set.proxy = &proxy;
     parse_set.exclude_remarks = &lExcludeRemarks;
     parse_set.include_remarks = &lIncludeRemarks;
-    parse_set.stream_rules = &stream_temp;
-    parse_set.time_rules = &time_temp;
+    parse_set.stream_rules = stream_temp.get();
+    parse_set.time_rules = time_temp.get();
     parse_set.sub_info = &subInfo;
     parse_set.authorized = authorized;
     string_icase_map subscription_headers = sanitizeSubscriptionRequestHeaders(request.headers);
@@ -638,8 +735,7 @@ std::string subconverter(RESPONSE_CALLBACK_ARGS) {
     if (authorized && !argFilterScript.empty())
         filterScript = argFilterScript;
     if (!filterScript.empty()) {
-        if (startsWith(filterScript, "path:"))
-            filterScript = fileGet(filterScript.substr(5), false);
+        FileView filterSource = startsWith(filterScript, "path:") ? fileView(filterScript.substr(5), false) : FileView(nullptr, filterScript);
         /*
         duk_context *ctx = duktape_init();
         if(ctx)
@@ -665,13 +761,37 @@ std::string subconverter(RESPONSE_CALLBACK_ARGS) {
         */
         script_safe_runner(ext.js_runtime, ext.js_context, [&](qjs::Context &ctx) {
             try {
-                ctx.eval(filterScript);
-                auto filter = (std::function<bool(const Proxy &)>) ctx.eval("filter");
-                nodes.erase(std::remove_if(nodes.begin(), nodes.end(), filter), nodes.end());
+                ctx.eval("globalThis.filterAll = undefined");
+                script_eval(ctx, filterSource.view());
+                if ((std::string) ctx.eval("typeof filterAll") == "function") {
+                    /// batch form: one call receives every node and returns a flag per node
+                    ProxyRefs refs;
+                    refs.reserve(nodes.size());
+                    for (const Proxy &x: nodes)
+                        refs.push_back(&x);
+                    auto filterAll = (std::function<std::vector<bool>(const ProxyRefs &)>) ctx.eval("filterAll");
+                    std::vector<bool> removed;
+                    {
+                        ScriptNodeScope scope(ctx);
+                        removed = filterAll(refs);
+                    }
+                    if (removed.size() == nodes.size()) {
+                        size_t index = 0;
+                        nodes.erase(std::remove_if(nodes.begin(), nodes.end(), [&](const Proxy &) { return removed[index++]; }), nodes.end());
+                    } else
+                        writeLog(0, "filterAll() returned " + std::to_string(removed.size()) + " results for " + std::to_string(nodes.size()) + " nodes, ignoring.", LOG_LEVEL_ERROR);
+                } else {
+                    auto filter = (std::function<bool(const Proxy &)>) ctx.eval("filter");
+                    auto scoped_filter = [&](const Proxy &x) {
+                        ScriptNodeScope scope(ctx);
+                        return filter(x);
+                    };
+                    nodes.erase(std::remove_if(nodes.begin(), nodes.end(), scoped_filter), nodes.end());
+                }
             } catch (qjs::exception) {
                 script_print_stack(ctx);
             }
-        }, global.scriptCleanContext);
+        }, global.scriptCleanContext, "filter");
     }
 
     //check custom group name
@@ -698,219 +818,247 @@ std::string subconverter(RESPONSE_CALLBACK_ARGS) {
 
     ProxyGroupConfigs dummy_group;
     std::vector<RulesetContent> dummy_ruleset;
-    std::string managed_url = base64Decode(getUrlArg(argument, "profile_data"));
-    if (managed_url.empty())
-        managed_url = global.managedConfigPrefix + "/sub?" + joinArguments(argument);
+    std::string managed_data = base64Decode(getUrlArg(argument, "profile_data"));
+    auto managedUrl = [&](const std::string &target) {
+        if (!managed_data.empty())
+            return managed_data;
+        if (!lBatch)
+            return global.managedConfigPrefix + "/sub?" + joinArguments(argument);
+        string_multimap target_argument = argument;
+        target_argument.erase("target");
+        target_argument.emplace("target", target);
+        return global.managedConfigPrefix + "/sub?" + joinArguments(target_argument);
+    };
+    auto upload = [](const std::string &name, const std::string &path, const std::string &content, bool writeManageURL) {
+        static std::mutex upload_mutex;
+        guarded_mutex guard(upload_mutex);
+        uploadGist(name, path, content, writeManageURL);
+    };
 
     //std::cerr<<"Generate target: ";
     proxy = parseProxy(global.proxyConfig);
-    switch (hash_(argTarget)) {
-        case "clash"_hash:
-        case "clashr"_hash:
-            writeLog(0, argTarget == "clashr" ? "Generate target: ClashR" : "Generate target: Clash", LOG_LEVEL_INFO);
-            tpl_args.local_vars["clash.new_field_name"] = ext.clash_new_field_name ? "true" : "false";
-            response.headers["profile-update-interval"] = std::to_string(interval / 3600);
-            if (ext.nodelist) {
-                YAML::Node yamlnode;
-                proxyToClash(nodes, yamlnode, dummy_group, argTarget == "clashr", ext);
-                output_content = formatterShortId(YAML::Dump(yamlnode));
-            } else {
-                if (render_template(fetchFile(lClashBase, proxy, global.cacheConfig), tpl_args, base_content,
-                                    global.templatePath) != 0) {
-                    *status_code = 400;
-                    return base_content;
+    auto generate = [&](const std::string &target, std::vector<Proxy> &nodes, std::vector<RulesetContent> &lRulesetContent,
+                        template_args &tpl_args, extra_settings &ext, string_icase_map &headers,
+                        int &status) -> std::string {
+        std::string base_content, output_content;
+        switch (hash_(target)) {
+            case "clash"_hash:
+            case "clashr"_hash:
+                writeLog(0, target == "clashr" ? "Generate target: ClashR" : "Generate target: Clash", LOG_LEVEL_INFO);
+                tpl_args.local_vars["clash.new_field_name"] = ext.clash_new_field_name ? "true" : "false";
+                headers["profile-update-interval"] = std::to_string(interval / 3600);
+                if (ext.nodelist) {
+                    YAML::Node yamlnode;
+                    proxyToClash(nodes, yamlnode, dummy_group, target == "clashr", ext);
+                    output_content = formatterShortId(YAML::Dump(yamlnode));
+                } else {
+                    if (render_template(fetchFile(lClashBase, proxy, global.cacheConfig), tpl_args, base_content,
+                                        global.templatePath) != 0) {
+                        status = 400;
+                        return base_content;
+                    }
+                    output_content = proxyToClash(nodes, base_content, lRulesetContent, lCustomProxyGroups,
+                                                  target == "clashr", ext);
                 }
-                output_content = proxyToClash(nodes, base_content, lRulesetContent, lCustomProxyGroups,
-                                              argTarget == "clashr", ext);
-            }
-
-            if (argUpload)
-                uploadGist(argTarget, argUploadPath, output_content, false);
-            break;
-        case "surge"_hash:
-
-            writeLog(0, "Generate target: Surge " + std::to_string(intSurgeVer), LOG_LEVEL_INFO);
-
-            if (ext.nodelist) {
-                output_content = proxyToSurge(nodes, base_content, dummy_ruleset, dummy_group, intSurgeVer, ext);
 
                 if (argUpload)
-                    uploadGist("surge" + argSurgeVer + "list", argUploadPath, output_content, true);
-            } else {
-                if (render_template(fetchFile(lSurgeBase, proxy, global.cacheConfig), tpl_args, base_content,
+                    upload(target, argUploadPath, output_content, false);
+                break;
+            case "surge"_hash:
+
+                writeLog(0, "Generate target: Surge " + std::to_string(intSurgeVer), LOG_LEVEL_INFO);
+
+                if (ext.nodelist) {
+                    output_content = proxyToSurge(nodes, base_content, dummy_ruleset, dummy_group, intSurgeVer, ext);
+
+                    if (argUpload)
+                        upload("surge" + argSurgeVer + "list", argUploadPath, output_content, true);
+                } else {
+                    if (render_template(fetchFile(lSurgeBase, proxy, global.cacheConfig), tpl_args, base_content,
+                                        global.templatePath) != 0) {
+                        status = 400;
+                        return base_content;
+                    }
+                    output_content = proxyToSurge(nodes, base_content, lRulesetContent, lCustomProxyGroups, intSurgeVer,
+                                                  ext);
+
+                    if (argUpload)
+                        upload("surge" + argSurgeVer, argUploadPath, output_content, true);
+
+                    if (global.writeManagedConfig && !global.managedConfigPrefix.empty())
+                        output_content = "#!MANAGED-CONFIG " + managedUrl(target) + (interval
+                                                                                  ? " interval=" + std::to_string(interval)
+                                                                                  : "")
+                                         + " strict=" + std::string(strict ? "true" : "false") + "\n\n" + output_content;
+                }
+                break;
+            case "surfboard"_hash:
+                writeLog(0, "Generate target: Surfboard", LOG_LEVEL_INFO);
+
+                if (render_template(fetchFile(lSurfboardBase, proxy, global.cacheConfig), tpl_args, base_content,
                                     global.templatePath) != 0) {
-                    *status_code = 400;
+                    status = 400;
                     return base_content;
                 }
-                output_content = proxyToSurge(nodes, base_content, lRulesetContent, lCustomProxyGroups, intSurgeVer,
-                                              ext);
-
+                output_content = proxyToSurge(nodes, base_content, lRulesetContent, lCustomProxyGroups, -3, ext);
                 if (argUpload)
-                    uploadGist("surge" + argSurgeVer, argUploadPath, output_content, true);
+                    upload("surfboard", argUploadPath, output_content, true);
 
                 if (global.writeManagedConfig && !global.managedConfigPrefix.empty())
-                    output_content = "#!MANAGED-CONFIG " + managed_url + (interval
+                    output_content = "#!MANAGED-CONFIG " + managedUrl(target) + (interval
                                                                               ? " interval=" + std::to_string(interval)
                                                                               : "")
                                      + " strict=" + std::string(strict ? "true" : "false") + "\n\n" + output_content;
-            }
-            break;
-        case "surfboard"_hash:
-            writeLog(0, "Generate target: Surfboard", LOG_LEVEL_INFO);
-
-            if (render_template(fetchFile(lSurfboardBase, proxy, global.cacheConfig), tpl_args, base_content,
-                                global.templatePath) != 0) {
-                *status_code = 400;
-                return base_content;
-            }
-            output_content = proxyToSurge(nodes, base_content, lRulesetContent, lCustomProxyGroups, -3, ext);
-            if (argUpload)
-                uploadGist("surfboard", argUploadPath, output_content, true);
-
-            if (global.writeManagedConfig && !global.managedConfigPrefix.empty())
-                output_content = "#!MANAGED-CONFIG " + managed_url + (interval
-                                                                          ? " interval=" + std::to_string(interval)
-                                                                          : "")
-                                 + " strict=" + std::string(strict ? "true" : "false") + "\n\n" + output_content;
-            break;
-        case "mellow"_hash:
-            writeLog(0, "Generate target: Mellow", LOG_LEVEL_INFO);
-
-            if (render_template(fetchFile(lMellowBase, proxy, global.cacheConfig), tpl_args, base_content,
-                                global.templatePath) != 0) {
-                *status_code = 400;
-                return base_content;
-            }
-            output_content = proxyToMellow(nodes, base_content, lRulesetContent, lCustomProxyGroups, ext);
-
-            if (argUpload)
-                uploadGist("mellow", argUploadPath, output_content, true);
-            break;
-        case "sssub"_hash:
-            writeLog(0, "Generate target: SS Subscription", LOG_LEVEL_INFO);
+                break;
+            case "mellow"_hash:
+                writeLog(0, "Generate target: Mellow", LOG_LEVEL_INFO);
 
-            if (render_template(fetchFile(lSSSubBase, proxy, global.cacheConfig), tpl_args, base_content,
-                                global.templatePath) != 0) {
-                *status_code = 400;
-                return base_content;
-            }
-            output_content = proxyToSSSub(base_content, nodes, ext);
-            if (argUpload)
-                uploadGist("sssub", argUploadPath, output_content, false);
-            break;
-        case "ss"_hash:
-            writeLog(0, "Generate target: SS", LOG_LEVEL_INFO);
-            output_content = proxyToSingle(nodes, 1, ext);
-            if (argUpload)
-                uploadGist("ss", argUploadPath, output_content, false);
-            break;
-        case "ssr"_hash:
-            writeLog(0, "Generate target: SSR", LOG_LEVEL_INFO);
-            output_content = proxyToSingle(nodes, 2, ext);
-            if (argUpload)
-                uploadGist("ssr", argUploadPath, output_content, false);
-            break;
-        case "v2ray"_hash:
-            writeLog(0, "Generate target: v2rayN", LOG_LEVEL_INFO);
-            output_content = proxyToSingle(nodes, 4, ext);
-            if (argUpload)
-                uploadGist("v2ray", argUploadPath, output_content, false);
-            break;
-        case "trojan"_hash:
-            writeLog(0, "Generate target: Trojan", LOG_LEVEL_INFO);
-            output_content = proxyToSingle(nodes, 8, ext);
-            if (argUpload)
-                uploadGist("trojan", argUploadPath, output_content, false);
-            break;
-        case "vless"_hash:
-            writeLog(0, "Generate target: vless", LOG_LEVEL_INFO);
-            output_content = proxyToSingle(nodes, 16, ext);
-            if (argUpload)
-                uploadGist("vless", argUploadPath, output_content, false);
-            break;
-        case "hysteria2"_hash:
-            writeLog(0, "Generate target: hysteria2", LOG_LEVEL_INFO);
-            output_content = proxyToSingle(nodes, 32, ext);
-            if (argUpload)
-                uploadGist("hysteria2", argUploadPath, output_content, false);
-            break;
-        case "mixed"_hash:
-            writeLog(0, "Generate target: Standard Subscription", LOG_LEVEL_INFO);
-            output_content = proxyToSingle(nodes, 63, ext);
-            if (argUpload)
-                uploadGist("sub", argUploadPath, output_content, false);
-            break;
-        case "quan"_hash:
-            writeLog(0, "Generate target: Quantumult", LOG_LEVEL_INFO);
-            if (!ext.nodelist) {
-                if (render_template(fetchFile(lQuanBase, proxy, global.cacheConfig), tpl_args, base_content,
+                if (render_template(fetchFile(lMellowBase, proxy, global.cacheConfig), tpl_args, base_content,
                                     global.templatePath) != 0) {
-                    *status_code = 400;
+                    status = 400;
                     return base_content;
                 }
-            }
+                output_content = proxyToMellow(nodes, base_content, lRulesetContent, lCustomProxyGroups, ext);
 
-            output_content = proxyToQuan(nodes, base_content, lRulesetContent, lCustomProxyGroups, ext);
+                if (argUpload)
+                    upload("mellow", argUploadPath, output_content, true);
+                break;
+            case "sssub"_hash:
+                writeLog(0, "Generate target: SS Subscription", LOG_LEVEL_INFO);
 
-            if (argUpload)
-                uploadGist("quan", argUploadPath, output_content, false);
-            break;
-        case "quanx"_hash:
-            writeLog(0, "Generate target: Quantumult X", LOG_LEVEL_INFO);
-            if (!ext.nodelist) {
-                if (render_template(fetchFile(lQuanXBase, proxy, global.cacheConfig), tpl_args, base_content,
+                if (render_template(fetchFile(lSSSubBase, proxy, global.cacheConfig), tpl_args, base_content,
                                     global.templatePath) != 0) {
-                    *status_code = 400;
+                    status = 400;
                     return base_content;
                 }
-            }
+                output_content = proxyToSSSub(base_content, nodes, ext);
+                if (argUpload)
+                    upload("sssub", argUploadPath, output_content, false);
+                break;
+            case "ss"_hash:
+                writeLog(0, "Generate target: SS", LOG_LEVEL_INFO);
+                output_content = proxyToSingle(nodes, 1, ext);
+                if (argUpload)
+                    upload("ss", argUploadPath, output_content, false);
+                break;
+            case "ssr"_hash:
+                writeLog(0, "Generate target: SSR", LOG_LEVEL_INFO);
+                output_content = proxyToSingle(nodes, 2, ext);
+                if (argUpload)
+                    upload("ssr", argUploadPath, output_content, false);
+                break;
+            case "v2ray"_hash:
+                writeLog(0, "Generate target: v2rayN", LOG_LEVEL_INFO);
+                output_content = proxyToSingle(nodes, 4, ext);
+                if (argUpload)
+                    upload("v2ray", argUploadPath, output_content, false);
+                break;
+            case "trojan"_hash:
+                writeLog(0, "Generate target: Trojan", LOG_LEVEL_INFO);
+                output_content = proxyToSingle(nodes, 8, ext);
+                if (argUpload)
+                    upload("trojan", argUploadPath, output_content, false);
+                break;
+            case "vless"_hash:
+                writeLog(0, "Generate target: vless", LOG_LEVEL_INFO);
+                output_content = proxyToSingle(nodes, 16, ext);
+                if (argUpload)
+                    upload("vless", argUploadPath, output_content, false);
+                break;
+            case "hysteria2"_hash:
+                writeLog(0, "Generate target: hysteria2", LOG_LEVEL_INFO);
+                output_content = proxyToSingle(nodes, 32, ext);
+                if (argUpload)
+                    upload("hysteria2", argUploadPath, output_content, false);
+                break;
+            case "mixed"_hash:
+                writeLog(0, "Generate target: Standard Subscription", LOG_LEVEL_INFO);
+                output_content = proxyToSingle(nodes, 63, ext);
+                if (argUpload)
+                    upload("sub", argUploadPath, output_content, false);
+                break;
+            case "quan"_hash:
+                writeLog(0, "Generate target: Quantumult", LOG_LEVEL_INFO);
+                if (!ext.nodelist) {
+                    if (render_template(fetchFile(lQuanBase, proxy, global.cacheConfig), tpl_args, base_content,
+                                        global.templatePath) != 0) {
+                        status = 400;
+                        return base_content;
+                    }
+                }
 
-            output_content = proxyToQuanX(nodes, base_content, lRulesetContent, lCustomProxyGroups, ext);
+                output_content = proxyToQuan(nodes, base_content, lRulesetContent, lCustomProxyGroups, ext);
 
-            if (argUpload)
-                uploadGist("quanx", argUploadPath, output_content, false);
-            break;
-        case "loon"_hash:
-            writeLog(0, "Generate target: Loon", LOG_LEVEL_INFO);
-            if (!ext.nodelist) {
-                if (render_template(fetchFile(lLoonBase, proxy, global.cacheConfig), tpl_args, base_content,
-                                    global.templatePath) != 0) {
-                    *status_code = 400;
-                    return base_content;
+                if (argUpload)
+                    upload("quan", argUploadPath, output_content, false);
+                break;
+            case "quanx"_hash:
+                writeLog(0, "Generate target: Quantumult X", LOG_LEVEL_INFO);
+                if (!ext.nodelist) {
+                    if (render_template(fetchFile(lQuanXBase, proxy, global.cacheConfig), tpl_args, base_content,
+                                        global.templatePath) != 0) {
+                        status = 400;
+                        return base_content;
+                    }
                 }
-            }
 
-            output_content = proxyToLoon(nodes, base_content, lRulesetContent, lCustomProxyGroups, ext);
+                output_content = proxyToQuanX(nodes, base_content, lRulesetContent, lCustomProxyGroups, ext);
 
-            if (argUpload)
-                uploadGist("loon", argUploadPath, output_content, false);
-            break;
-        case "ssd"_hash:
-            writeLog(0, "Generate target: SSD", LOG_LEVEL_INFO);
-            output_content = proxyToSSD(nodes, argGroupName, subInfo, ext);
-            if (argUpload)
-                uploadGist("ssd", argUploadPath, output_content, false);
-            break;
-        case "singbox"_hash:
-            writeLog(0, "Generate target: sing-box", LOG_LEVEL_INFO);
-            if (!ext.nodelist) {
-                if (render_template(fetchFile(lSingBoxBase, proxy, global.cacheConfig), tpl_args, base_content,
-                                    global.templatePath) != 0) {
-                    *status_code = 400;
-                    return base_content;
+                if (argUpload)
+                    upload("quanx", argUploadPath, output_content, false);
+                break;
+            case "loon"_hash:
+                writeLog(0, "Generate target: Loon", LOG_LEVEL_INFO);
+                if (!ext.nodelist) {
+                    if (render_template(fetchFile(lLoonBase, proxy, global.cacheConfig), tpl_args, base_content,
+                                        global.templatePath) != 0) {
+                        status = 400;
+                        return base_content;
+                    }
                 }
-            }
 
-            output_content = proxyToSingBox(nodes, base_content, lRulesetContent, lCustomProxyGroups, ext);
+                output_content = proxyToLoon(nodes, base_content, lRulesetContent, lCustomProxyGroups, ext);
 
-            if (argUpload)
-                uploadGist("singbox", argUploadPath, output_content, false);
-            break;
-        default:
-            writeLog(0, "Generate target: Unspecified", LOG_LEVEL_INFO);
-            *status_code = 500;
-            return "Unrecognized target";
-    }
+                if (argUpload)
+                    upload("loon", argUploadPath, output_content, false);
+                break;
+            case "ssd"_hash:
+                writeLog(0, "Generate target: SSD", LOG_LEVEL_INFO);
+                output_content = proxyToSSD(nodes, argGroupName, subInfo, ext);
+                if (argUpload)
+                    upload("ssd", argUploadPath, output_content, false);
+                break;
+            case "singbox"_hash:
+                writeLog(0, "Generate target: sing-box", LOG_LEVEL_INFO);
+                if (!ext.nodelist) {
+                    if (render_template(fetchFile(lSingBoxBase, proxy, global.cacheConfig), tpl_args, base_content,
+                                        global.templatePath) != 0) {
+                        status = 400;
+                        return base_content;
+                    }
+                }
+
+                output_content = proxyToSingBox(nodes, base_content, lRulesetContent, lCustomProxyGroups, ext);
+
+                if (argUpload)
+                    upload("singbox", argUploadPath, output_content, false);
+                break;
+            default:
+                writeLog(0, "Generate target: Unspecified", LOG_LEVEL_INFO);
+                status = 500;
+                return "Unrecognized target";
+        }
+        return output_content;
+    };
+
+    if (lBatch)
+        return generateBatch(argTargets, argFilename, nodes, lRulesetContent, tpl_args, ext, setTargetOptions, generate,
+                             response);
+
+    std::string output_content = generate(argTarget, nodes, lRulesetContent, tpl_args, ext, response.headers,
+                                          response.status_code);
+    if (response.status_code != 200)
+        return output_content;
     writeLog(0, "Generate completed.", LOG_LEVEL_INFO);
     if (!argFilename.empty())
         response.headers.emplace("Content-Disposition",
@@ -1031,7 +1179,7 @@ std::string surgeConfToClash(RESPONSE_CALLBACK_ARGS) {
     proxy = parseProxy(global.proxySubscription);
     eraseElements(dummy_str_array);
 
-    RegexMatchConfigs dummy_regex_array;
+    RegexReplacers dummy_regex_array;
     std::string subInfo;
     parse_settings parse_set;
     parse_set.proxy = &proxy;
@@ -1294,7 +1442,7 @@ std::string subInfoToMessage(std::string subinfo) {
 int simpleGenerator() {
     //std::cerr<<"\nReading generator configuration...\n";
     writeLog(0, "Reading generator configuration...", LOG_LEVEL_INFO);
-    std::string config = fileGet("generate.ini"), path, profile, content;
+    std::string config = fileGet("generate.ini");
     if (config.empty()) {
         //std::cerr<<"Generator configuration not found or empty!\n";
         writeLog(0, "Generator configuration not found or empty!", LOG_LEVEL_ERROR);
@@ -1331,68 +1479,122 @@ int simpleGenerator() {
     //std::cerr<<"Generating all artifacts...\n";
         writeLog(0, "Generating all artifacts...", LOG_LEVEL_INFO);
 
-    string_multimap allItems;
-    std::string proxy = parseProxy(global.proxySubscription);
-    Request request;
-    Response response;
+    /// read every artifact first, the workers below do not touch the INIReader
+    struct Artifact {
+        std::string name;
+        string_multimap items;
+        int result = -1;
+        long long duration = 0;
+    };
+    std::vector<Artifact> artifacts;
     for (std::string &x: sections) {
-        response.status_code = 200;
+        Artifact artifact;
+        artifact.name = x;
+        ini.get_items(x, artifact.items);
+        artifacts.emplace_back(std::move(artifact));
+    }
+
+    std::string proxy = parseProxy(global.proxySubscription);
+    /// returns 0 on success, 1 if the artifact was skipped and -1 on error
+    auto generate = [&](const Artifact &artifact) {
+        const std::string &x = artifact.name;
+        auto getItem = [&](const std::string &name) -> std::string {
+            auto iter = artifact.items.find(name);
+            return iter != artifact.items.end() ? iter->second : "";
+        };
+        Request request;
+        Response response;
+        std::string path, profile, content;
         //std::cerr<<"Generating artifact '"<<x<<"'...\n";
         writeLog(0, "Generating artifact '" + x + "'...", LOG_LEVEL_INFO);
-        ini.enter_section(x);
-        if (ini.item_exist("path"))
-            path = ini.get("path");
+        if (artifact.items.contains("path"))
+            path = getItem("path");
         else {
             //std::cerr<<"Artifact '"<<x<<"' output path missing! Skipping...\n\n";
             writeLog(0, "Artifact '" + x + "' output path missing! Skipping...\n", LOG_LEVEL_ERROR);
-            continue;
+            return 1;
         }
-        if (ini.item_exist("profile")) {
-            profile = ini.get("profile");
+        if (artifact.items.contains("profile")) {
+            profile = getItem("profile");
             request.argument.emplace("name", urlEncode(profile));
             request.argument.emplace("token", global.accessToken);
             request.argument.emplace("expand", "true");
             content = getProfile(request, response);
         } else {
-            if (ini.get_bool("direct")) {
-                std::string url = ini.get("url");
+            if (getItem("direct") == "true") {
+                std::string url = getItem("url");
                 content = fetchFile(url, proxy, global.cacheSubscription, true,
                                     FetchPurpose::SubscriptionProvider);
                 if (content.empty()) {
                     //std::cerr<<"Artifact '"<<x<<"' generate ERROR! Please check your link.\n\n";
                     writeLog(0, "Artifact '" + x + "' generate ERROR! Please check your link.\n", LOG_LEVEL_ERROR);
-                    if (sections.size() == 1)
-                        return -1;
+                    return -1;
                 }
                 // add UTF-8 BOM
-                fileWrite(path, "\xEF\xBB\xBF" + content, true);
-                continue;
+                if (fileWriteAtomic(path, "\xEF\xBB\xBF" + content) != 0) {
+                    writeLog(0, "Artifact '" + x + "' could not be written to '" + path + "'!\n", LOG_LEVEL_ERROR);
+                    return -1;
+                }
+                return 0;
             }
-            ini.get_items(allItems);
-            allItems.emplace("expand", "true");
-            for (auto &y: allItems) {
+            for (auto &y: artifact.items) {
                 if (y.first == "path")
                     continue;
                 request.argument.emplace(y.first, y.second);
             }
+            request.argument.emplace("expand", "true");
             content = subconverter(request, response);
         }
         if (response.status_code != 200) {
             //std::cerr<<"Artifact '"<<x<<"' generate ERROR! Reason: "<<content<<"\n\n";
             writeLog(0, "Artifact '" + x + "' generate ERROR! Reason: " + content + "\n", LOG_LEVEL_ERROR);
-            if (sections.size() == 1)
-                return -1;
-            continue;
+            return -1;
+        }
+        if (fileWriteAtomic(path, content) != 0) {
+            writeLog(0, "Artifact '" + x + "' could not be written to '" + path + "'!\n", LOG_LEVEL_ERROR);
+            return -1;
         }
-        fileWrite(path, content, true);
         auto iter = std::find_if(response.headers.begin(), response.headers.end(),
                                  [](auto y) { return y.first == "Subscription-UserInfo"; });
         if (iter != response.headers.end())
             writeLog(0, "User Info for artifact '" + x + "': " + subInfoToMessage(iter->second), LOG_LEVEL_INFO);
         //std::cerr<<"Artifact '"<<x<<"' generate SUCCESS!\n\n";
         writeLog(0, "Artifact '" + x + "' generate SUCCESS!\n", LOG_LEVEL_INFO);
-        eraseElements(response.headers);
+        return 0;
+    };
+
+    /// artifacts spend most of their time waiting on the network, so several are built at once,
+    /// sharing the fetch and ruleset caches
+    std::atomic_size_t next_artifact = 0;
+    auto worker = [&]() {
+        size_t index;
+        while ((index = next_artifact++) < artifacts.size()) {
+            Artifact &artifact = artifacts[index];
+            auto start = std::chrono::steady_clock::now();
+            try {
+                artifact.result = generate(artifact);
+            } catch (std::exception &e) {
+                writeLog(0, "Artifact '" + artifact.name + "' generate ERROR! Reason: " + e.what() + "\n", LOG_LEVEL_ERROR);
+            }
+            artifact.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+    };
+    size_t worker_count = std::min<size_t>(std::max(global.maxConcurThreads, 1), artifacts.size());
+    std::vector<std::future<void>> workers;
+    for (size_t i = 1; i < worker_count; i++)
+        workers.emplace_back(std::async(std::launch::async, worker));
+    worker();
+    for (auto &x: workers)
+        x.get();
+
+    writeLog(0, "Artifact summary:", LOG_LEVEL_INFO);
+    for (Artifact &x: artifacts) {
+        std::string state = x.result == 0 ? "SUCCESS" : x.result > 0 ? "SKIPPED" : "ERROR";
+        writeLog(0, "  " + x.name + ": " + state + " in " + std::to_string(x.duration) + " ms", LOG_LEVEL_INFO);
     }
+    if (artifacts.size() == 1 && artifacts[0].result < 0)
+        return -1;
     //std::cerr<<"All artifact generated. Exiting...\n";
     writeLog(0, "All artifact generated. Exiting...", LOG_LEVEL_INFO);
     return 0;
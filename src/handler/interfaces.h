@@ -14,7 +14,7 @@ std::string parseProxy(const std::string &source);
 void refreshRulesets(RulesetConfigs &ruleset_list, std::vector<RulesetContent> &rca);
 void readConf();
 int simpleGenerator();
-std::string convertRuleset(const std::string &content, int type);
+std::string convertRuleset(std::string_view content, int type);
 
 std::string getProfile(RESPONSE_CALLBACK_ARGS);
 std::string getRuleset(RESPONSE_CALLBACK_ARGS);
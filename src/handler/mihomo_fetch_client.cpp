@@ -2,13 +2,18 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cerrno>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <limits>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <set>
@@ -90,8 +95,14 @@ using json = nlohmann::json;
 constexpr std::uint64_t protocol_version = 1;
 constexpr std::uint32_t max_request_frame = 4U << 20;
 constexpr std::uint32_t max_response_frame = 128U << 20;
+constexpr std::size_t read_buffer_size = 64U << 10;
 constexpr std::uintmax_t max_manifest_size = 1U << 20;
 constexpr auto startup_timeout = std::chrono::seconds(5);
+constexpr auto response_timeout = std::chrono::milliseconds(25000);
+constexpr auto reader_poll_interval = std::chrono::milliseconds(100);
+constexpr auto health_check_interval = std::chrono::seconds(1);
+// Matches maxConcurrency in the helper, which stops reading requests while all of its slots are busy.
+constexpr std::size_t max_in_flight = 8;
 constexpr int max_fetch_attempts = 2;
 
 bool isTransientFetchError(const std::string &error_code)
@@ -487,6 +498,7 @@ public:
             CloseHandle(stdout_read_);
             stdout_read_ = nullptr;
         }
+        read_begin_ = read_end_ = 0;
         if(process_)
         {
             if(WaitForSingleObject(process_, 250) == WAIT_TIMEOUT)
@@ -508,6 +520,7 @@ public:
             close(stdout_read_);
             stdout_read_ = -1;
         }
+        read_begin_ = read_end_ = 0;
         if(child_pid_ > 0)
         {
             if(!waitForExit(child_pid_, std::chrono::milliseconds(100)))
@@ -540,6 +553,17 @@ public:
     std::optional<std::vector<std::uint8_t>> readFrame(std::chrono::milliseconds timeout)
     {
         const auto deadline = std::chrono::steady_clock::now() + timeout;
+        const auto length = readFrameLength(deadline);
+        if(!length)
+            return std::nullopt;
+        std::vector<std::uint8_t> payload(*length);
+        if(!readExact(payload.data(), payload.size(), deadline))
+            return std::nullopt;
+        return payload;
+    }
+
+    std::optional<std::uint32_t> readFrameLength(std::chrono::steady_clock::time_point deadline)
+    {
         std::array<std::uint8_t, 4> size{};
         if(!readExact(size.data(), size.size(), deadline))
             return std::nullopt;
@@ -549,10 +573,73 @@ public:
                             static_cast<std::uint32_t>(size[3]);
         if(length == 0 || length > max_response_frame)
             return std::nullopt;
-        std::vector<std::uint8_t> payload(length);
-        if(!readExact(payload.data(), payload.size(), deadline))
-            return std::nullopt;
-        return payload;
+        return length;
+    }
+
+    // Reads are served from a small buffer so that the many short CBOR items of a frame do
+    // not each cost a system call; reads at least as large as the buffer bypass it.
+    bool readExact(std::uint8_t *data, std::size_t length,
+                   std::chrono::steady_clock::time_point deadline)
+    {
+        while(length > 0)
+        {
+            if(read_begin_ < read_end_)
+            {
+                const std::size_t chunk = std::min(length, read_end_ - read_begin_);
+                std::copy_n(read_buffer_.data() + read_begin_, chunk, data);
+                read_begin_ += chunk;
+                data += chunk;
+                length -= chunk;
+                continue;
+            }
+            if(read_buffer_.empty())
+                read_buffer_.resize(read_buffer_size);
+            const bool direct = length >= read_buffer_.size();
+            std::uint8_t *target = direct ? data : read_buffer_.data();
+            const std::size_t capacity = direct ? length : read_buffer_.size();
+            const auto read_count = readSome(target, capacity, deadline);
+            if(read_count == 0)
+                return false;
+            if(direct)
+            {
+                data += read_count;
+                length -= read_count;
+            }
+            else
+            {
+                read_begin_ = 0;
+                read_end_ = read_count;
+            }
+        }
+        return true;
+    }
+
+    // Returns false only when the timeout elapses with nothing to read. Errors and hang-ups
+    // report true so that the following readFrame() observes them.
+    bool waitReadable(std::chrono::milliseconds timeout)
+    {
+        if(read_begin_ < read_end_)
+            return true;
+#ifdef _WIN32
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while(true)
+        {
+            DWORD available = 0;
+            if(!stdout_read_ || !PeekNamedPipe(stdout_read_, nullptr, 0, nullptr, &available, nullptr) || available > 0)
+                return true;
+            if(process_ && WaitForSingleObject(process_, 0) != WAIT_TIMEOUT)
+                return true;
+            if(std::chrono::steady_clock::now() >= deadline)
+                return false;
+            Sleep(10);
+        }
+#else
+        if(stdout_read_ < 0)
+            return true;
+        pollfd descriptor {stdout_read_, POLLIN, 0};
+        const int ready = poll(&descriptor, 1, static_cast<int>(timeout.count()));
+        return ready > 0 || (ready < 0 && errno != EINTR);
+#endif
     }
 
 private:
@@ -617,46 +704,46 @@ private:
         return true;
     }
 
-    bool readExact(std::uint8_t *data, std::size_t length,
-                   std::chrono::steady_clock::time_point deadline)
+    // Returns the number of bytes read, or zero on timeout, error or end of stream.
+    std::size_t readSome(std::uint8_t *data, std::size_t capacity,
+                         std::chrono::steady_clock::time_point deadline)
     {
-        while(length > 0)
+        while(true)
         {
             const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
             if(remaining <= std::chrono::milliseconds::zero())
-                return false;
+                return 0;
 #ifdef _WIN32
             if(!stdout_read_)
-                return false;
+                return 0;
             DWORD available = 0;
             if(!PeekNamedPipe(stdout_read_, nullptr, 0, nullptr, &available, nullptr))
-                return false;
+                return 0;
             if(available == 0)
             {
                 if(process_ && WaitForSingleObject(process_, 0) != WAIT_TIMEOUT)
-                    return false;
+                    return 0;
                 Sleep(10);
                 continue;
             }
             DWORD read_count = 0;
-            const DWORD chunk = static_cast<DWORD>(std::min<std::size_t>({length, available, std::numeric_limits<DWORD>::max()}));
+            const DWORD chunk = static_cast<DWORD>(std::min<std::size_t>({capacity, available, std::numeric_limits<DWORD>::max()}));
             if(!ReadFile(stdout_read_, data, chunk, &read_count, nullptr) || read_count == 0)
-                return false;
+                return 0;
+            return read_count;
 #else
             if(stdout_read_ < 0)
-                return false;
+                return 0;
             pollfd descriptor {stdout_read_, POLLIN, 0};
             const int poll_timeout = static_cast<int>(std::min<std::int64_t>(remaining.count(), std::numeric_limits<int>::max()));
             if(poll(&descriptor, 1, poll_timeout) <= 0 || !(descriptor.revents & (POLLIN | POLLHUP)))
-                return false;
-            const ssize_t read_count = read(stdout_read_, data, length);
+                return 0;
+            const ssize_t read_count = read(stdout_read_, data, capacity);
             if(read_count <= 0)
-                return false;
+                return 0;
+            return static_cast<std::size_t>(read_count);
 #endif
-            data += read_count;
-            length -= static_cast<std::size_t>(read_count);
         }
-        return true;
     }
 
 #ifdef _WIN32
@@ -668,121 +755,300 @@ private:
     int stdout_read_ = -1;
     pid_t child_pid_ = -1;
 #endif
+    std::vector<std::uint8_t> read_buffer_;
+    std::size_t read_begin_ = 0;
+    std::size_t read_end_ = 0;
 };
 
-class MihomoFetchClient
+// The fields of a helper response that the client consumes.
+struct HelperResponse
+{
+    std::string type;
+    std::uint64_t id = 0;
+    int status = 0;
+    std::map<std::string, std::vector<std::string>> headers;
+    std::string body;
+    std::string body_hash;
+    std::string error_code;
+};
+
+// Decodes one response frame straight from the helper pipe. The body byte string is read
+// directly into HelperResponse::body, so a multi-megabyte subscription is copied once, from
+// the pipe into the string that becomes the fetch result. Unknown fields are skipped, and
+// indefinite-length items, which the helper never sends, are rejected.
+class ResponseDecoder
 {
 public:
-    int fetch(const FetchArgument &argument, FetchResult &result)
+    ResponseDecoder(HelperProcess &process, std::uint32_t length, std::chrono::steady_clock::time_point deadline)
+        : process_(process), remaining_(length), deadline_(deadline) {}
+
+    bool decode(HelperResponse &response)
+    {
+        std::uint64_t fields = 0;
+        if(!expectHead(5, fields))
+            return false;
+        std::string key;
+        for(std::uint64_t index = 0; index < fields; ++index)
+        {
+            if(!readText(key))
+                return false;
+            bool decoded = true;
+            if(key == "type")
+                decoded = readText(response.type);
+            else if(key == "id")
+                decoded = readUnsigned(response.id);
+            else if(key == "status")
+                decoded = readStatus(response.status);
+            else if(key == "headers")
+                decoded = readHeaders(response.headers);
+            else if(key == "body")
+                decoded = readBytesOrSkip(response.body);
+            else if(key == "body_hash")
+                decoded = readTextOrSkip(response.body_hash);
+            else if(key == "error_code")
+                decoded = readText(response.error_code);
+            else
+                decoded = skip(0);
+            if(!decoded)
+                return false;
+        }
+        return remaining_ == 0;
+    }
+
+private:
+    static constexpr int max_depth = 8;
+
+    bool take(std::uint8_t *data, std::size_t length)
     {
-        std::lock_guard<std::mutex> guard(io_mutex_);
-        if(!ensureStarted())
-            return fail(result, "Mihomo subscription transport is unavailable");
+        if(length > remaining_)
+            return false;
+        remaining_ -= length;
+        return process_.readExact(data, length, deadline_);
+    }
 
-        json headers = json::object();
-        if(argument.request_headers)
+    bool peekMajor(std::uint8_t &major)
+    {
+        if(!has_peeked_)
         {
-            for(const auto &[name, value] : *argument.request_headers)
-                headers[name] = json::array({value});
+            if(!take(&peeked_, 1))
+                return false;
+            has_peeked_ = true;
         }
+        major = peeked_ >> 5;
+        return true;
+    }
 
-        json request = {
-            {"type", "fetch"},
-            {"url", argument.url},
-            {"headers", std::move(headers)},
-            {"proxy", argument.proxy},
-            {"old_hash", argument.old_hash ? *argument.old_hash : std::string()},
-            {"timeout_ms", 20000},
-            {"size_limit", global.maxAllowedDownloadSize},
-        };
-        for(int attempt = 1; attempt <= max_fetch_attempts; ++attempt)
+    bool readHead(std::uint8_t &major, std::uint64_t &argument)
+    {
+        std::uint8_t initial = 0;
+        if(has_peeked_)
         {
-            const std::uint64_t request_id = next_request_id_++;
-            request["id"] = request_id;
-            const auto payload = json::to_cbor(request);
-            if(!process_.writeFrame(payload))
+            initial = peeked_;
+            has_peeked_ = false;
+        }
+        else if(!take(&initial, 1))
+            return false;
+        major = initial >> 5;
+        const std::uint8_t info = initial & 0x1f;
+        if(info < 24)
+        {
+            argument = info;
+            return true;
+        }
+        if(info > 27)
+            return false;
+        const std::size_t size = std::size_t{1} << (info - 24);
+        std::array<std::uint8_t, 8> bytes{};
+        if(!take(bytes.data(), size))
+            return false;
+        argument = 0;
+        for(std::size_t index = 0; index < size; ++index)
+            argument = (argument << 8) | bytes[index];
+        return true;
+    }
+
+    bool expectHead(std::uint8_t expected_major, std::uint64_t &argument)
+    {
+        std::uint8_t major = 0;
+        return readHead(major, argument) && major == expected_major;
+    }
+
+    bool readInto(std::string &target, std::uint64_t length)
+    {
+        if(length > remaining_)
+            return false;
+        target.resize(static_cast<std::size_t>(length));
+        return take(reinterpret_cast<std::uint8_t *>(target.data()), target.size());
+    }
+
+    bool readText(std::string &target)
+    {
+        std::uint64_t length = 0;
+        return expectHead(3, length) && readInto(target, length);
+    }
+
+    bool readTextOrSkip(std::string &target)
+    {
+        std::uint8_t major = 0;
+        if(!peekMajor(major))
+            return false;
+        return major == 3 ? readText(target) : skip(0);
+    }
+
+    bool readBytesOrSkip(std::string &target)
+    {
+        std::uint8_t major = 0;
+        if(!peekMajor(major))
+            return false;
+        if(major != 2)
+            return skip(0);
+        std::uint64_t length = 0;
+        return expectHead(2, length) && readInto(target, length);
+    }
+
+    bool readUnsigned(std::uint64_t &target)
+    {
+        return expectHead(0, target);
+    }
+
+    bool readStatus(int &target)
+    {
+        std::uint8_t major = 0;
+        std::uint64_t argument = 0;
+        if(!readHead(major, argument) || (major != 0 && major != 1) ||
+           argument > static_cast<std::uint64_t>(std::numeric_limits<int>::max()))
+            return false;
+        target = major == 0 ? static_cast<int>(argument) : -1 - static_cast<int>(argument);
+        return true;
+    }
+
+    // Repeated headers arrive as a map of name to an array of values. Entries of any other
+    // shape are skipped, matching what the client has always accepted.
+    bool readHeaders(std::map<std::string, std::vector<std::string>> &target)
+    {
+        std::uint8_t major = 0;
+        if(!peekMajor(major))
+            return false;
+        if(major != 5)
+            return skip(0);
+        std::uint64_t entries = 0;
+        if(!expectHead(5, entries))
+            return false;
+        std::string name;
+        for(std::uint64_t entry = 0; entry < entries; ++entry)
+        {
+            if(!peekMajor(major))
+                return false;
+            if(major != 3)
             {
-                invalidate();
-                return fail(result, "Mihomo subscription transport write failed");
+                if(!skip(1) || !skip(1))
+                    return false;
+                continue;
             }
-
-            const auto timeout = std::chrono::milliseconds(25000);
-            auto response_frame = process_.readFrame(timeout);
-            if(!response_frame)
+            if(!readText(name) || !peekMajor(major))
+                return false;
+            if(major != 4)
             {
-                invalidate();
-                return fail(result, "Mihomo subscription transport timed out");
+                if(!skip(1))
+                    return false;
+                continue;
             }
-
-            try
+            std::uint64_t count = 0;
+            if(!expectHead(4, count))
+                return false;
+            auto &values = target[name];
+            values.clear();
+            for(std::uint64_t index = 0; index < count; ++index)
             {
-                const json response = json::from_cbor(*response_frame, true, true);
-                if(response.value("type", "") != "response" || response.value("id", std::uint64_t{0}) != request_id)
-                {
-                    invalidate();
-                    return fail(result, "Mihomo subscription transport protocol mismatch");
-                }
-                const int status = response.value("status", 0);
-                *result.status_code = status;
-                if(result.content)
-                {
-                    result.content->clear();
-                    if(response.contains("body") && response["body"].is_binary())
-                    {
-                        const auto &body = response["body"].get_binary();
-                        result.content->assign(reinterpret_cast<const char *>(body.data()), body.size());
-                    }
-                }
-                if(result.response_headers)
-                {
-                    result.response_headers->clear();
-                    if(response.contains("headers") && response["headers"].is_object())
-                    {
-                        for(const auto &[name, values] : response["headers"].items())
-                        {
-                            if(!values.is_array())
-                                continue;
-                            for(const auto &value : values)
-                            {
-                                if(value.is_string())
-                                    *result.response_headers += name + ": " + value.get<std::string>() + "\r\n";
-                            }
-                        }
-                    }
-                }
-                if(result.body_hash)
-                {
-                    result.body_hash->clear();
-                    if(response.contains("body_hash") && response["body_hash"].is_string())
-                        *result.body_hash = response["body_hash"].get<std::string>();
-                }
-
-                const std::string error_code = response.value("error_code", "");
-                if(error_code.empty())
-                    return status;
-                if(attempt < max_fetch_attempts && isTransientFetchError(error_code))
+                if(!peekMajor(major))
+                    return false;
+                if(major != 3)
                 {
-                    invalidate();
-                    if(!ensureStarted())
-                        return fail(result, "Mihomo subscription transport is unavailable");
+                    if(!skip(2))
+                        return false;
                     continue;
                 }
-                return fail(result, "Mihomo subscription request failed", status);
+                if(!readText(values.emplace_back()))
+                    return false;
             }
-            catch(const std::exception &)
+        }
+        return true;
+    }
+
+    bool skip(int depth)
+    {
+        if(depth > max_depth)
+            return false;
+        std::uint8_t major = 0;
+        std::uint64_t argument = 0;
+        if(!readHead(major, argument))
+            return false;
+        switch(major)
+        {
+        case 0:
+        case 1:
+        case 7:
+            return true;
+        case 2:
+        case 3:
+        {
+            if(argument > remaining_)
+                return false;
+            std::array<std::uint8_t, 256> discard{};
+            while(argument > 0)
             {
-                invalidate();
-                return fail(result, "Mihomo subscription transport returned invalid data");
+                const std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(argument, discard.size()));
+                if(!take(discard.data(), chunk))
+                    return false;
+                argument -= chunk;
             }
+            return true;
+        }
+        case 4:
+        case 5:
+        {
+            const std::uint64_t items = major == 5 ? argument * 2 : argument;
+            if(items > remaining_ || (major == 5 && argument > remaining_))
+                return false;
+            for(std::uint64_t index = 0; index < items; ++index)
+            {
+                if(!skip(depth + 1))
+                    return false;
+            }
+            return true;
+        }
+        case 6:
+            return skip(depth + 1);
+        default:
+            return false;
         }
-        return fail(result, "Mihomo subscription request failed");
     }
 
-private:
-    bool ensureStarted()
+    HelperProcess &process_;
+    std::size_t remaining_;
+    std::chrono::steady_clock::time_point deadline_;
+    std::uint8_t peeked_ = 0;
+    bool has_peeked_ = false;
+};
+
+// One verified helper process. Request frames are written whole under write_mutex_, and a
+// reader thread hands every response frame to the request waiting on its id, so up to
+// max_in_flight fetches share the pipe at once.
+class HelperChannel
+{
+public:
+    using Response = std::optional<HelperResponse>;
+
+    HelperChannel() = default;
+    HelperChannel(const HelperChannel &) = delete;
+    HelperChannel &operator=(const HelperChannel &) = delete;
+    ~HelperChannel()
+    {
+        close();
+    }
+
+    bool open()
     {
-        if(started_)
-            return true;
         const auto helper = locateHelper();
         if(!helper)
             return false;
@@ -826,10 +1092,462 @@ private:
             process_.stop();
             return false;
         }
-        started_ = true;
+        alive_ = true;
+        reader_ = std::thread(&HelperChannel::readLoop, this);
         return true;
     }
 
+    bool alive() const
+    {
+        return alive_;
+    }
+
+    // Requests written and not yet answered, plus those still waiting for a slot.
+    std::size_t outstanding()
+    {
+        std::lock_guard<std::mutex> guard(pending_mutex_);
+        return pending_.size() + waiting_;
+    }
+
+    // Waits for a free request slot and writes the frame. The future yields the matching
+    // response, or std::nullopt once the channel fails.
+    std::optional<std::future<Response>> send(std::uint64_t id, const std::vector<std::uint8_t> &payload)
+    {
+        std::future<Response> response;
+        {
+            std::unique_lock<std::mutex> lock(pending_mutex_);
+            ++waiting_;
+            slot_available_.wait(lock, [this] { return !alive_ || pending_.size() < max_in_flight; });
+            --waiting_;
+            if(!alive_)
+                return std::nullopt;
+            response = pending_[id].get_future();
+        }
+        bool written;
+        {
+            std::lock_guard<std::mutex> guard(write_mutex_);
+            written = process_.writeFrame(payload);
+        }
+        if(written)
+            return response;
+        std::lock_guard<std::mutex> guard(pending_mutex_);
+        pending_.erase(id);
+        slot_available_.notify_one();
+        return std::nullopt;
+    }
+
+    // Gives up on one request, e.g. after it timed out. Its late response is discarded
+    // instead of being taken for a protocol error, so other requests on the channel go on.
+    void abandon(std::uint64_t id)
+    {
+        {
+            std::lock_guard<std::mutex> guard(pending_mutex_);
+            if(!pending_.erase(id))
+                return; // answered in the meantime
+            abandoned_.insert(id);
+        }
+        slot_available_.notify_one();
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> guard(close_mutex_);
+        closing_ = true;
+        if(reader_.joinable())
+            reader_.join();
+        {
+            std::lock_guard<std::mutex> write_guard(write_mutex_);
+            process_.stop();
+        }
+        failPending();
+    }
+
+private:
+    void readLoop()
+    {
+        while(!closing_)
+        {
+            if(!process_.waitReadable(reader_poll_interval))
+                continue;
+            const auto deadline = std::chrono::steady_clock::now() + response_timeout;
+            const auto length = process_.readFrameLength(deadline);
+            if(!length)
+                break;
+            HelperResponse response;
+            if(!ResponseDecoder(process_, *length, deadline).decode(response))
+            {
+                writeLog(0, "Mihomo subscription transport returned invalid data", LOG_LEVEL_ERROR);
+                break;
+            }
+            if(!dispatch(std::move(response)))
+                break;
+        }
+        failPending();
+    }
+
+    bool dispatch(HelperResponse &&response)
+    {
+        std::promise<Response> promise;
+        {
+            std::lock_guard<std::mutex> guard(pending_mutex_);
+            const auto iterator = response.type == "response" ? pending_.find(response.id) : pending_.end();
+            if(iterator == pending_.end())
+            {
+                if(response.type == "response" && abandoned_.erase(response.id))
+                    return true;
+                writeLog(0, "Mihomo subscription transport protocol mismatch", LOG_LEVEL_ERROR);
+                return false;
+            }
+            promise = std::move(iterator->second);
+            pending_.erase(iterator);
+        }
+        slot_available_.notify_one();
+        promise.set_value(std::move(response));
+        return true;
+    }
+
+    void failPending()
+    {
+        std::map<std::uint64_t, std::promise<Response>> orphaned;
+        {
+            std::lock_guard<std::mutex> guard(pending_mutex_);
+            alive_ = false;
+            orphaned.swap(pending_);
+            abandoned_.clear();
+        }
+        slot_available_.notify_all();
+        for(auto &[id, promise] : orphaned)
+            promise.set_value(std::nullopt);
+    }
+
+    HelperProcess process_;
+    std::thread reader_;
+    std::mutex write_mutex_;
+    std::mutex close_mutex_;
+    std::mutex pending_mutex_;
+    std::condition_variable slot_available_;
+    std::map<std::uint64_t, std::promise<Response>> pending_;
+    std::set<std::uint64_t> abandoned_;
+    std::size_t waiting_ = 0;
+    std::atomic<bool> alive_ {false};
+    std::atomic<bool> closing_ {false};
+};
+
+class HelperPool;
+HelperPool &pool();
+
+// Keeps global.mihomoFetcherPoolSize helpers running plus one warm spare. Requests go to the
+// member with the fewest outstanding requests, and a member that dies or is retired is
+// replaced by the spare at once while a background thread starts the next spare.
+class HelperPool
+{
+public:
+    HelperPool() = default;
+    HelperPool(const HelperPool &) = delete;
+    HelperPool &operator=(const HelperPool &) = delete;
+    ~HelperPool()
+    {
+        shutdown();
+    }
+
+    void shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> guard(state_mutex_);
+            stopping_ = true;
+        }
+        maintenance_wakeup_.notify_all();
+        if(maintenance_.joinable())
+            maintenance_.join();
+    }
+
+    std::shared_ptr<HelperChannel> acquire()
+    {
+        Retired retired; // declared first, so the channels are released after the lock
+        std::lock_guard<std::mutex> guard(state_mutex_);
+        resizeLocked(retired);
+        std::shared_ptr<HelperChannel> best;
+        std::size_t best_outstanding = 0;
+        for(auto &member : members_)
+        {
+            if(member && !member->alive())
+                replaceLocked(member, retired);
+            if(!member)
+                continue;
+            const std::size_t outstanding = member->outstanding();
+            if(!best || outstanding < best_outstanding)
+            {
+                best = member;
+                best_outstanding = outstanding;
+            }
+        }
+        if(best)
+            return best;
+
+        // nothing is running yet, so this request has to wait for a helper anyway
+        auto channel = std::make_shared<HelperChannel>();
+        if(!channel->open())
+        {
+            ++start_failures_;
+            return nullptr;
+        }
+        ++started_;
+        members_.front() = channel;
+        if(!maintenance_.joinable())
+        {
+            // Registered after the first handshake has initialized the statics it uses, so
+            // the thread is joined at exit before they are destroyed.
+            maintenance_ = std::thread(&HelperPool::maintain, this);
+            std::atexit([] { pool().shutdown(); });
+        }
+        else
+            maintenance_wakeup_.notify_one();
+        return channel;
+    }
+
+    // Takes a member out of rotation. Requests still in flight on it keep their reference,
+    // and the helper is stopped once the last of them releases it.
+    void retire(const std::shared_ptr<HelperChannel> &channel)
+    {
+        Retired retired;
+        std::lock_guard<std::mutex> guard(state_mutex_);
+        for(auto &member : members_)
+        {
+            if(member == channel)
+                replaceLocked(member, retired);
+        }
+    }
+
+    MihomoFetcherStats stats()
+    {
+        std::lock_guard<std::mutex> guard(state_mutex_);
+        MihomoFetcherStats result;
+        result.pool_size = members_.empty() ? configuredSize() : members_.size();
+        for(const auto &member : members_)
+        {
+            if(!member || !member->alive())
+                continue;
+            ++result.running;
+            result.in_flight += member->outstanding();
+        }
+        result.spare_ready = spare_ && spare_->alive();
+        result.started = started_;
+        result.restarts = restarts_;
+        result.start_failures = start_failures_;
+        return result;
+    }
+
+private:
+    static std::size_t configuredSize()
+    {
+        return static_cast<std::size_t>(std::max(global.mihomoFetcherPoolSize, 1));
+    }
+
+    // Channels taken out of the pool while state_mutex_ is held. Dropping the last reference
+    // stops the helper, which can take a while, so they are only released after unlocking.
+    using Retired = std::vector<std::shared_ptr<HelperChannel>>;
+
+    void resizeLocked(Retired &retired)
+    {
+        while(members_.size() > configuredSize())
+        {
+            retired.push_back(std::move(members_.back()));
+            members_.pop_back();
+        }
+        if(members_.size() < configuredSize())
+            members_.resize(configuredSize());
+    }
+
+    void replaceLocked(std::shared_ptr<HelperChannel> &member, Retired &retired)
+    {
+        ++restarts_;
+        retired.push_back(std::move(member));
+        if(spare_ && spare_->alive())
+            member = std::move(spare_);
+        if(spare_)
+            retired.push_back(std::move(spare_));
+        maintenance_wakeup_.notify_one();
+    }
+
+    // Restarts dead members and keeps the spare warm. Helpers are started without holding
+    // state_mutex_, so a slow start never blocks request dispatch.
+    void maintain()
+    {
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        bool more_work = false;
+        while(!stopping_)
+        {
+            if(!more_work)
+                maintenance_wakeup_.wait_for(lock, health_check_interval);
+            more_work = false;
+            if(stopping_)
+                break;
+            if(std::none_of(members_.begin(), members_.end(), [](const auto &member) { return member != nullptr; }))
+                continue; // not in use yet, or waiting for acquire() to start the first helper
+            Retired retired;
+            for(auto &member : members_)
+            {
+                if(member && !member->alive())
+                    replaceLocked(member, retired);
+            }
+            if(spare_ && !spare_->alive())
+                retired.push_back(std::move(spare_));
+            if(!retired.empty())
+            {
+                lock.unlock();
+                retired.clear();
+                lock.lock();
+                if(stopping_)
+                    break;
+            }
+            const bool need_member = std::any_of(members_.begin(), members_.end(), [](const auto &member) { return member == nullptr; });
+            if(spare_ && spare_->alive())
+            {
+                if(!need_member)
+                    continue;
+                for(auto &member : members_)
+                {
+                    if(!member)
+                    {
+                        member = std::move(spare_);
+                        break;
+                    }
+                }
+                spare_.reset();
+            }
+
+            lock.unlock();
+            auto channel = std::make_shared<HelperChannel>();
+            const bool opened = channel->open();
+            lock.lock();
+            if(!opened)
+            {
+                ++start_failures_;
+                continue;
+            }
+            ++started_;
+            if(stopping_)
+            {
+                lock.unlock(); // stop the unused helper outside the lock too
+                break;
+            }
+            spare_ = std::move(channel);
+            more_work = true;
+        }
+    }
+
+    std::mutex state_mutex_;
+    std::condition_variable maintenance_wakeup_;
+    std::thread maintenance_;
+    std::vector<std::shared_ptr<HelperChannel>> members_;
+    std::shared_ptr<HelperChannel> spare_;
+    std::uint64_t started_ = 0;
+    std::uint64_t restarts_ = 0;
+    std::uint64_t start_failures_ = 0;
+    bool stopping_ = false;
+};
+
+HelperPool &pool()
+{
+    static HelperPool instance;
+    return instance;
+}
+
+// Runs one fetch against the pool. A transient helper error retires the helper that
+// served it and retries once on another one.
+class MihomoFetchClient
+{
+public:
+    explicit MihomoFetchClient(HelperPool &pool) : pool_(pool) {}
+
+    int fetch(const FetchArgument &argument, FetchResult &result)
+    {
+        json headers = json::object();
+        if(argument.request_headers)
+        {
+            for(const auto &[name, value] : *argument.request_headers)
+                headers[name] = json::array({value});
+        }
+
+        json request = {
+            {"type", "fetch"},
+            {"url", argument.url},
+            {"headers", std::move(headers)},
+            {"proxy", argument.proxy},
+            {"old_hash", argument.old_hash ? *argument.old_hash : std::string()},
+            {"timeout_ms", 20000},
+            {"size_limit", global.maxAllowedDownloadSize},
+        };
+        for(int attempt = 1; attempt <= max_fetch_attempts; ++attempt)
+        {
+            if(!channel_ && !ensureStarted())
+                return fail(result, "Mihomo subscription transport is unavailable");
+            const auto channel = channel_;
+
+            const std::uint64_t request_id = next_request_id_++;
+            request["id"] = request_id;
+            auto pending = channel->send(request_id, json::to_cbor(request));
+            if(!pending)
+            {
+                channel->close();
+                return fail(result, "Mihomo subscription transport write failed");
+            }
+            if(pending->wait_for(response_timeout) != std::future_status::ready)
+            {
+                channel->abandon(request_id);
+                return fail(result, "Mihomo subscription transport timed out");
+            }
+            auto response_frame = pending->get();
+            if(!response_frame)
+                return fail(result, "Mihomo subscription transport was interrupted");
+            auto &response = *response_frame;
+
+            try
+            {
+                const int status = response.status;
+                *result.status_code = status;
+                if(result.content)
+                    *result.content = std::move(response.body);
+                if(result.response_headers)
+                {
+                    result.response_headers->clear();
+                    for(const auto &[name, values] : response.headers)
+                    {
+                        for(const auto &value : values)
+                            *result.response_headers += name + ": " + value + "\r\n";
+                    }
+                }
+                if(result.body_hash)
+                    *result.body_hash = std::move(response.body_hash);
+
+                const std::string &error_code = response.error_code;
+                if(error_code.empty())
+                    return status;
+                if(attempt < max_fetch_attempts && isTransientFetchError(error_code))
+                {
+                    invalidate();
+                    if(!ensureStarted())
+                        return fail(result, "Mihomo subscription transport is unavailable");
+                    continue;
+                }
+                return fail(result, "Mihomo subscription request failed", status);
+            }
+            catch(const std::exception &)
+            {
+                invalidate();
+                return fail(result, "Mihomo subscription transport returned invalid data");
+            }
+        }
+        return fail(result, "Mihomo subscription request failed");
+    }
+
+private:
+    bool ensureStarted()
+    {
+        channel_ = pool_.acquire();
+        return channel_ != nullptr;
+    }
+
     int fail(FetchResult &result, const std::string &message, int status = 0)
     {
         *result.status_code = status;
@@ -845,24 +1563,23 @@ private:
 
     void invalidate()
     {
-        started_ = false;
-        process_.stop();
+        pool_.retire(channel_);
+        channel_.reset();
     }
 
-    std::mutex io_mutex_;
-    HelperProcess process_;
-    std::uint64_t next_request_id_ = 1;
-    bool started_ = false;
+    static inline std::atomic<std::uint64_t> next_request_id_ {1};
+    HelperPool &pool_;
+    std::shared_ptr<HelperChannel> channel_;
 };
 
-MihomoFetchClient &client()
-{
-    static MihomoFetchClient instance;
-    return instance;
-}
 }
 
 int mihomoFetch(const FetchArgument &argument, FetchResult &result)
 {
-    return client().fetch(argument, result);
+    return MihomoFetchClient(pool()).fetch(argument, result);
+}
+
+MihomoFetcherStats mihomoFetcherStats()
+{
+    return pool().stats();
 }
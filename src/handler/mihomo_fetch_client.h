@@ -1,10 +1,27 @@
 #ifndef MIHOMO_FETCH_CLIENT_H_INCLUDED
 #define MIHOMO_FETCH_CLIENT_H_INCLUDED
 
+#include <cstddef>
+#include <cstdint>
+
 #include "handler/webget.h"
 
 // Executes one strict subscription-provider request through the bundled,
 // identity-checked Mihomo helper. It never falls back to libcurl.
 int mihomoFetch(const FetchArgument &argument, FetchResult &result);
 
+struct MihomoFetcherStats
+{
+    std::size_t pool_size = 0;
+    std::size_t running = 0;
+    std::size_t in_flight = 0;
+    bool spare_ready = false;
+    std::uint64_t started = 0;
+    std::uint64_t restarts = 0;
+    std::uint64_t start_failures = 0;
+};
+
+// Occupancy and lifetime counters of the helper pool, for the status endpoint.
+MihomoFetcherStats mihomoFetcherStats();
+
 #endif // MIHOMO_FETCH_CLIENT_H_INCLUDED
@@ -2,6 +2,7 @@
 #include <thread>
 
 #include "handler/settings.h"
+#include "utils/logger.h"
 #include "utils/network.h"
 #include "webget.h"
 #include "multithread.h"
@@ -9,6 +10,25 @@
 
 //safety lock for multi-thread
 std::mutex on_emoji, on_rename, on_stream, on_time;
+//userinfo rules are compiled when they are set, not on every request
+static std::shared_ptr<const RegexReplacers> compiled_streams = std::make_shared<RegexReplacers>(), compiled_times = std::make_shared<RegexReplacers>();
+
+static std::shared_ptr<const RegexReplacers> compileRules(const RegexMatchConfigs &rules)
+{
+    auto compiled = std::make_shared<RegexReplacers>();
+    compiled->reserve(rules.size());
+    for(const RegexMatchConfig &x : rules)
+    {
+        RegexReplacer rule(x.Match, x.Replace);
+        if(!rule.valid())
+        {
+            writeLog(0, "Invalid userinfo rule '" + x.Match + "', ignoring.", LOG_LEVEL_WARNING);
+            continue;
+        }
+        compiled->emplace_back(std::move(rule));
+    }
+    return compiled;
+}
 
 RegexMatchConfigs safe_get_emojis()
 {
@@ -22,16 +42,16 @@ RegexMatchConfigs safe_get_renames()
     return global.renames;
 }
 
-RegexMatchConfigs safe_get_streams()
+std::shared_ptr<const RegexReplacers> safe_get_streams()
 {
     guarded_mutex guard(on_stream);
-    return global.streamNodeRules;
+    return compiled_streams;
 }
 
-RegexMatchConfigs safe_get_times()
+std::shared_ptr<const RegexReplacers> safe_get_times()
 {
     guarded_mutex guard(on_time);
-    return global.timeNodeRules;
+    return compiled_times;
 }
 
 void safe_set_emojis(RegexMatchConfigs data)
@@ -48,27 +68,31 @@ void safe_set_renames(RegexMatchConfigs data)
 
 void safe_set_streams(RegexMatchConfigs data)
 {
+    auto compiled = compileRules(data);
     guarded_mutex guard(on_stream);
     global.streamNodeRules.swap(data);
+    compiled_streams.swap(compiled);
 }
 
 void safe_set_times(RegexMatchConfigs data)
 {
+    auto compiled = compileRules(data);
     guarded_mutex guard(on_time);
     global.timeNodeRules.swap(data);
+    compiled_times.swap(compiled);
 }
 
-std::shared_future<std::string> fetchFileAsync(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local, bool async, FetchPurpose purpose)
+std::shared_future<FileView> fetchFileAsync(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local, bool async, FetchPurpose purpose)
 {
-    std::shared_future<std::string> retVal;
+    std::shared_future<FileView> retVal;
     /*if(vfs::vfs_exist(path))
         retVal = std::async(std::launch::async, [path](){return vfs::vfs_get(path);});
     else */if(find_local && fileExist(path, true))
-        retVal = std::async(std::launch::async, [path](){return fileGet(path, true);});
+        retVal = std::async(std::launch::async, [path](){return fileView(path, true);});
     else if(isLink(path))
-        retVal = std::async(std::launch::async, [path, proxy, cache_ttl, purpose](){return webGet(path, proxy, cache_ttl, nullptr, nullptr, purpose);});
+        retVal = std::async(std::launch::async, [path, proxy, cache_ttl, purpose](){return webGetView(path, proxy, cache_ttl, nullptr, nullptr, purpose);});
     else
-        return std::async(std::launch::async, [](){return std::string();});
+        return std::async(std::launch::async, [](){return FileView();});
     if(!async)
         retVal.wait();
     return retVal;
@@ -76,5 +100,10 @@ std::shared_future<std::string> fetchFileAsync(const std::string &path, const st
 
 std::string fetchFile(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local, FetchPurpose purpose)
 {
-    return fetchFileAsync(path, proxy, cache_ttl, find_local, false, purpose).get();
+    //no need for a thread when waiting anyway, and a fresh download is handed back without a copy
+    if(find_local && fileExist(path, true))
+        return fileView(path, true).str();
+    if(isLink(path))
+        return webGet(path, proxy, cache_ttl, nullptr, nullptr, purpose);
+    return "";
 }
@@ -9,21 +9,22 @@
 #include "config/regmatch.h"
 #include "handler/webget.h"
 #include "utils/ini_reader/ini_reader.h"
+#include "utils/regexp.h"
 #include "utils/string.h"
 
 using guarded_mutex = std::lock_guard<std::mutex>;
 
 RegexMatchConfigs safe_get_emojis();
 RegexMatchConfigs safe_get_renames();
-RegexMatchConfigs safe_get_streams();
-RegexMatchConfigs safe_get_times();
+std::shared_ptr<const RegexReplacers> safe_get_streams();
+std::shared_ptr<const RegexReplacers> safe_get_times();
 YAML::Node safe_get_clash_base();
 INIReader safe_get_mellow_base();
 void safe_set_emojis(RegexMatchConfigs data);
 void safe_set_renames(RegexMatchConfigs data);
 void safe_set_streams(RegexMatchConfigs data);
 void safe_set_times(RegexMatchConfigs data);
-std::shared_future<std::string> fetchFileAsync(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local = true, bool async = false, FetchPurpose purpose = FetchPurpose::Generic);
+std::shared_future<FileView> fetchFileAsync(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local = true, bool async = false, FetchPurpose purpose = FetchPurpose::Generic);
 std::string fetchFile(const std::string &path, const std::string &proxy, int cache_ttl, bool find_local = true, FetchPurpose purpose = FetchPurpose::Generic);
 
 #endif // MULTITHREAD_H_INCLUDED
@@ -260,7 +260,7 @@ void refreshRulesets(RulesetConfigs &ruleset_list, std::vector<RulesetContent> &
         if(pos != std::string::npos)
         {
             writeLog(0, "Adding rule '" + rule_url.substr(pos + 2) + "," + rule_group + "'.", LOG_LEVEL_INFO);
-            rc = {rule_group, "", "", "", RULESET_SURGE, std::async(std::launch::async, [=](){return rule_url.substr(pos);}), 0};
+            rc = {rule_group, "", "", "", RULESET_SURGE, std::async(std::launch::async, [=](){return FileView(rule_url.substr(pos));}), 0};
         }
         else
         {
@@ -553,13 +553,19 @@ void readYAMLConf(YAML::Node &node)
                 node["advanced"]["cache_config"] >> global.cacheConfig;
                 node["advanced"]["cache_ruleset"] >> global.cacheRuleset;
                 node["advanced"]["serve_cache_on_fetch_fail"] >> global.serveCacheOnFetchFail;
+                node["advanced"]["cache_max_size"] >> global.cacheMaxSize;
+                node["advanced"]["cache_max_age"] >> global.cacheMaxAge;
+                node["advanced"]["cache_stale_while_revalidate"] >> global.cacheStaleWhileRevalidate;
             }
             else
                 global.cacheSubscription = global.cacheConfig = global.cacheRuleset = 0; //disable cache
         }
         node["advanced"]["script_clean_context"] >> global.scriptCleanContext;
+        node["advanced"]["script_timeout"] >> global.scriptTimeout;
+        node["advanced"]["script_memory_limit"] >> global.scriptMemoryLimit;
         node["advanced"]["async_fetch_ruleset"] >> global.asyncFetchRuleset;
         node["advanced"]["skip_failed_links"] >> global.skipFailedLinks;
+        node["advanced"]["mihomo_fetcher_pool_size"] >> global.mihomoFetcherPoolSize;
     }
     writeLog(0, "Load preference settings in YAML format completed.", LOG_LEVEL_INFO);
 }
@@ -735,9 +741,15 @@ void readTOMLConf(toml::value &root)
                   "cache_subscription", cache_subscription,
                   "cache_config", cache_config,
                   "cache_ruleset", cache_ruleset,
+                  "cache_max_size", global.cacheMaxSize,
+                  "cache_max_age", global.cacheMaxAge,
+                  "cache_stale_while_revalidate", global.cacheStaleWhileRevalidate,
                   "script_clean_context", global.scriptCleanContext,
+                  "script_timeout", global.scriptTimeout,
+                  "script_memory_limit", global.scriptMemoryLimit,
                   "async_fetch_ruleset", global.asyncFetchRuleset,
-                  "skip_failed_links", global.skipFailedLinks
+                  "skip_failed_links", global.skipFailedLinks,
+                  "mihomo_fetcher_pool_size", global.mihomoFetcherPoolSize
     );
 
     if(global.printDbgInfo)
@@ -1056,6 +1068,9 @@ void readConf()
             ini.get_int_if_exist("cache_config", global.cacheConfig);
             ini.get_int_if_exist("cache_ruleset", global.cacheRuleset);
             ini.get_bool_if_exist("serve_cache_on_fetch_fail", global.serveCacheOnFetchFail);
+            ini.get_int_if_exist("cache_max_size", global.cacheMaxSize);
+            ini.get_int_if_exist("cache_max_age", global.cacheMaxAge);
+            ini.get_int_if_exist("cache_stale_while_revalidate", global.cacheStaleWhileRevalidate);
         }
         else
         {
@@ -1064,8 +1079,11 @@ void readConf()
         }
     }
     ini.get_bool_if_exist("script_clean_context", global.scriptCleanContext);
+    ini.get_int_if_exist("script_timeout", global.scriptTimeout);
+    ini.get_int_if_exist("script_memory_limit", global.scriptMemoryLimit);
     ini.get_bool_if_exist("async_fetch_ruleset", global.asyncFetchRuleset);
     ini.get_bool_if_exist("skip_failed_links", global.skipFailedLinks);
+    ini.get_int_if_exist("mihomo_fetcher_pool_size", global.mihomoFetcherPoolSize);
 
     writeLog(0, "Load preference settings in INI format completed.", LOG_LEVEL_INFO);
 }
@@ -62,10 +62,13 @@ struct Settings
     //cache system
     bool serveCacheOnFetchFail = false;
     int cacheSubscription = 60, cacheConfig = 300, cacheRuleset = 21600;
+    int cacheMaxSize = 256, cacheMaxAge = 604800, cacheStaleWhileRevalidate = 0;
 
     //limits
     size_t maxAllowedRulesets = 64, maxAllowedRules = 32768;
     bool scriptCleanContext = false;
+    int scriptTimeout = 10000, scriptMemoryLimit = 128;
+    int mihomoFetcherPoolSize = 1;
 
     //cron system
     bool enableCron = false;
@@ -0,0 +1,444 @@
+#include "handler/webcache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "handler/settings.h"
+#include "utils/file.h"
+#include "utils/logger.h"
+
+namespace
+{
+
+constexpr auto cache_root = "cache";
+constexpr auto index_path = "cache/index";
+constexpr auto maintenance_interval = std::chrono::seconds(60);
+
+std::string shardPath(const std::string &key)
+{
+    return std::string(cache_root) + "/" + key.substr(0, 2);
+}
+
+std::string entryPath(const std::string &key)
+{
+    return shardPath(key) + "/" + key;
+}
+
+bool isDirectory(const std::string &path)
+{
+    struct stat st {};
+    return stat(path.data(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// An entry file is the header length on its own line, then the headers, then the body,
+// so both are published together by a single rename.
+std::string packEntry(const std::string &content, const std::string &headers)
+{
+    std::string data = std::to_string(headers.size()) + "\n";
+    data.reserve(data.size() + headers.size() + content.size());
+    data += headers;
+    data += content;
+    return data;
+}
+
+bool unpackEntry(const FileView &entry, FileView &content, std::string *headers)
+{
+    std::string_view data = entry.view();
+    std::string_view::size_type line_end = data.find('\n');
+    if(line_end == std::string_view::npos || line_end == 0)
+        return false;
+    char *end = nullptr;
+    unsigned long long header_size = std::strtoull(data.data(), &end, 10);
+    if(end != data.data() + line_end || header_size > data.size() - line_end - 1)
+        return false;
+    if(headers)
+        headers->assign(data.substr(line_end + 1, header_size));
+    content = entry.substr(line_end + 1 + header_size);
+    return true;
+}
+
+class DiskCache;
+DiskCache &cache();
+
+// Keeps the index of entries in memory and hands every disk write to one background
+// thread. Lookups never touch the disk for a key the index knows nothing about, except
+// for a single stat() to pick up entries written after the index was last saved.
+class DiskCache
+{
+public:
+    bool stat(const std::string &key, time_t &stored_at)
+    {
+        {
+            std::lock_guard<std::mutex> guard(state_mutex_);
+            startLocked();
+            if(auto iter = pending_.find(key); iter != pending_.end())
+            {
+                stored_at = iter->second.stored_at;
+                return true;
+            }
+            if(auto iter = index_.find(key); iter != index_.end())
+            {
+                stored_at = iter->second.stored_at;
+                return true;
+            }
+        }
+
+        struct stat st {};
+        if(::stat(entryPath(key).data(), &st) != 0 || !S_ISREG(st.st_mode))
+            return false;
+        std::lock_guard<std::mutex> guard(state_mutex_);
+        if(auto iter = index_.find(key); iter != index_.end())
+        {
+            stored_at = iter->second.stored_at;
+            return true;
+        }
+        indexLocked(key, st.st_mtime, st.st_size);
+        stored_at = st.st_mtime;
+        return true;
+    }
+
+    bool read(const std::string &key, FileView &content, std::string *headers)
+    {
+        {
+            std::lock_guard<std::mutex> guard(state_mutex_);
+            startLocked();
+            if(auto iter = pending_.find(key); iter != pending_.end())
+            {
+                content = FileView(iter->second.content, *iter->second.content);
+                if(headers)
+                    *headers = *iter->second.headers;
+                return true;
+            }
+        }
+
+        // entries are only ever replaced through rename(), so they are safe to map
+        if(unpackEntry(fileView(entryPath(key), true, true), content, headers))
+            return true;
+        // evicted or flushed since it was looked up, or damaged
+        std::lock_guard<std::mutex> guard(state_mutex_);
+        unindexLocked(key);
+        return false;
+    }
+
+    void store(const std::string &key, std::string content, std::string headers)
+    {
+        std::lock_guard<std::mutex> guard(state_mutex_);
+        startLocked();
+        PendingWrite &write = pending_[key];
+        if(!write.queued)
+            queue_.push_back(key);
+        write.queued = true;
+        write.content = std::make_shared<const std::string>(std::move(content));
+        write.headers = std::make_shared<const std::string>(std::move(headers));
+        write.stored_at = time(nullptr);
+        write.generation = ++generation_;
+        wakeup_.notify_one();
+    }
+
+    void flush()
+    {
+        // waits for a write in progress, so nothing is published after the files are gone
+        std::lock_guard<std::mutex> publishing(publish_mutex_);
+        {
+            std::lock_guard<std::mutex> guard(state_mutex_);
+            startLocked();
+            pending_.clear();
+            queue_.clear();
+            index_.clear();
+            total_size_ = 0;
+            index_dirty_ = true;
+        }
+        operateFiles(cache_root, [](const std::string &name)
+        {
+            std::string path = std::string(cache_root) + "/" + name;
+            if(isDirectory(path))
+                operateFiles(path, [&path](const std::string &file){ std::remove((path + "/" + file).data()); return 0; });
+            else
+                std::remove(path.data());
+            return 0;
+        });
+    }
+
+    void shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> guard(state_mutex_);
+            stopping_ = true;
+        }
+        wakeup_.notify_all();
+        if(writer_.joinable())
+            writer_.join();
+    }
+
+private:
+    struct IndexEntry
+    {
+        time_t stored_at = 0;
+        std::uint64_t size = 0;
+    };
+
+    struct PendingWrite
+    {
+        std::shared_ptr<const std::string> content, headers;
+        time_t stored_at = 0;
+        std::uint64_t generation = 0;
+        bool queued = false;
+    };
+
+    void startLocked()
+    {
+        if(started_)
+            return;
+        started_ = true;
+        md(cache_root);
+        if(!loadIndexLocked())
+            rebuildIndexLocked();
+        writer_ = std::thread(&DiskCache::writeLoop, this);
+        // registered after the instance is constructed, so it runs before the destructor
+        std::atexit([] { cache().shutdown(); });
+    }
+
+    void indexLocked(const std::string &key, time_t stored_at, std::uint64_t size)
+    {
+        IndexEntry &entry = index_[key];
+        total_size_ = total_size_ - entry.size + size;
+        entry.stored_at = stored_at;
+        entry.size = size;
+        index_dirty_ = true;
+    }
+
+    void unindexLocked(const std::string &key)
+    {
+        auto iter = index_.find(key);
+        if(iter == index_.end())
+            return;
+        total_size_ -= iter->second.size;
+        index_.erase(iter);
+        index_dirty_ = true;
+    }
+
+    // One "<key> <stored at> <size>" line per entry.
+    bool loadIndexLocked()
+    {
+        std::string data = fileGet(index_path, true);
+        if(data.empty())
+            return false;
+        const char *cur = data.data(), *last = data.data() + data.size();
+        while(cur < last)
+        {
+            const char *line_end = std::find(cur, last, '\n');
+            const char *key_end = std::find(cur, line_end, ' ');
+            if(key_end != line_end && key_end - cur > 2)
+            {
+                char *end = nullptr;
+                time_t stored_at = std::strtoll(key_end + 1, &end, 10);
+                std::uint64_t size = std::strtoull(end, nullptr, 10);
+                indexLocked(std::string(cur, key_end), stored_at, size);
+            }
+            cur = line_end + 1;
+        }
+        index_dirty_ = false;
+        writeLog(0, "Loaded " + std::to_string(index_.size()) + " cache entries from index.", LOG_LEVEL_VERBOSE);
+        return true;
+    }
+
+    // Only runs when there is no index yet. Also clears out the flat layout of older versions.
+    void rebuildIndexLocked()
+    {
+        operateFiles(cache_root, [this](const std::string &name)
+        {
+            std::string path = std::string(cache_root) + "/" + name;
+            if(!isDirectory(path))
+            {
+                std::remove(path.data());
+                return 0;
+            }
+            operateFiles(path, [&](const std::string &file)
+            {
+                struct stat st {};
+                std::string file_path = path + "/" + file;
+                if(file.size() > 4 && file.compare(file.size() - 4, 4, ".tmp") == 0)
+                    std::remove(file_path.data());
+                else if(::stat(file_path.data(), &st) == 0 && S_ISREG(st.st_mode))
+                    indexLocked(file, st.st_mtime, st.st_size);
+                return 0;
+            });
+            return 0;
+        });
+        index_dirty_ = true;
+    }
+
+    void saveIndex()
+    {
+        std::string data;
+        {
+            std::lock_guard<std::mutex> guard(state_mutex_);
+            if(!index_dirty_)
+                return;
+            data.reserve(index_.size() * 56);
+            for(const auto &[key, entry] : index_)
+                data += key + " " + std::to_string(entry.stored_at) + " " + std::to_string(entry.size) + "\n";
+            index_dirty_ = false;
+        }
+        if(fileWriteAtomic(index_path, data) != 0)
+            writeLog(0, "Failed to save cache index.", LOG_LEVEL_WARNING);
+    }
+
+    // Called with publish_mutex_ held.
+    void publish(const std::string &key, const PendingWrite &write)
+    {
+        std::string data = packEntry(*write.content, *write.headers);
+        md(shardPath(key).data());
+        bool written = fileWriteAtomic(entryPath(key), data) == 0;
+        if(!written)
+            writeLog(0, "Failed to write cache entry '" + key + "'.", LOG_LEVEL_WARNING);
+
+        std::lock_guard<std::mutex> guard(state_mutex_);
+        auto iter = pending_.find(key);
+        if(written)
+            indexLocked(key, write.stored_at, data.size());
+        if(iter != pending_.end() && iter->second.generation == write.generation)
+            pending_.erase(iter);
+    }
+
+    // Called with publish_mutex_ held. Drops entries past global.cacheMaxAge, then the oldest
+    // ones until the rest fit in global.cacheMaxSize.
+    void evict()
+    {
+        std::vector<std::string> victims;
+        {
+            std::lock_guard<std::mutex> guard(state_mutex_);
+            const time_t now = time(nullptr);
+            const std::uint64_t max_size = static_cast<std::uint64_t>(std::max(global.cacheMaxSize, 0)) * 1048576;
+            std::vector<std::pair<time_t, const std::string*>> by_age;
+            by_age.reserve(index_.size());
+            for(const auto &[key, entry] : index_)
+                by_age.emplace_back(entry.stored_at, &key);
+            std::sort(by_age.begin(), by_age.end());
+            std::uint64_t remaining = total_size_;
+            for(const auto &[stored_at, key] : by_age)
+            {
+                bool expired = global.cacheMaxAge > 0 && difftime(now, stored_at) > global.cacheMaxAge;
+                if(!expired && (max_size == 0 || remaining <= max_size))
+                    break;
+                remaining -= index_.at(*key).size;
+                victims.push_back(*key);
+            }
+            for(const auto &key : victims)
+                unindexLocked(key);
+        }
+        for(const auto &key : victims)
+            std::remove(entryPath(key).data());
+        if(!victims.empty())
+            writeLog(0, "Evicted " + std::to_string(victims.size()) + " cache entries.", LOG_LEVEL_VERBOSE);
+    }
+
+    bool overSizeLocked() const
+    {
+        return global.cacheMaxSize > 0 && total_size_ > static_cast<std::uint64_t>(global.cacheMaxSize) * 1048576;
+    }
+
+    // Publishes the oldest queued entry. Returns false if there was none.
+    bool writeNext()
+    {
+        std::lock_guard<std::mutex> publishing(publish_mutex_);
+        std::string key;
+        PendingWrite write;
+        {
+            std::lock_guard<std::mutex> guard(state_mutex_);
+            if(queue_.empty())
+                return false;
+            key = std::move(queue_.front());
+            queue_.pop_front();
+            auto iter = pending_.find(key);
+            if(iter == pending_.end())
+                return true;
+            iter->second.queued = false;
+            write = iter->second;
+        }
+        publish(key, write);
+        bool over_size;
+        {
+            std::lock_guard<std::mutex> guard(state_mutex_);
+            over_size = overSizeLocked();
+        }
+        if(over_size)
+            evict();
+        return true;
+    }
+
+    void writeLoop()
+    {
+        auto next_maintenance = std::chrono::steady_clock::now() + maintenance_interval;
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        // drains the queue before stopping, so nothing stored before exit is lost
+        while(!stopping_ || !queue_.empty())
+        {
+            if(queue_.empty())
+                wakeup_.wait_until(lock, next_maintenance);
+            lock.unlock();
+            if(!writeNext() && std::chrono::steady_clock::now() >= next_maintenance)
+            {
+                {
+                    std::lock_guard<std::mutex> publishing(publish_mutex_);
+                    evict();
+                }
+                saveIndex();
+                next_maintenance = std::chrono::steady_clock::now() + maintenance_interval;
+            }
+            lock.lock();
+        }
+        lock.unlock();
+        saveIndex();
+    }
+
+    std::mutex state_mutex_, publish_mutex_;
+    std::condition_variable wakeup_;
+    std::thread writer_;
+    bool started_ = false, stopping_ = false, index_dirty_ = false;
+    std::unordered_map<std::string, IndexEntry> index_;
+    std::unordered_map<std::string, PendingWrite> pending_;
+    std::deque<std::string> queue_;
+    std::uint64_t total_size_ = 0, generation_ = 0;
+};
+
+DiskCache &cache()
+{
+    static DiskCache instance;
+    return instance;
+}
+
+}
+
+bool webCacheStat(const std::string &key, time_t &stored_at)
+{
+    return cache().stat(key, stored_at);
+}
+
+bool webCacheRead(const std::string &key, FileView &content, std::string *headers)
+{
+    return cache().read(key, content, headers);
+}
+
+void webCacheStore(const std::string &key, std::string content, std::string headers)
+{
+    cache().store(key, std::move(content), std::move(headers));
+}
+
+void webCacheFlush()
+{
+    cache().flush();
+}
@@ -0,0 +1,23 @@
+#ifndef WEBCACHE_H_INCLUDED
+#define WEBCACHE_H_INCLUDED
+
+#include <ctime>
+#include <string>
+
+#include "utils/file.h"
+
+// Disk cache behind webGet(). Entries live under cache/<first two hex digits>/<key>, where
+// key is the MD5 of webCacheIdentity(). Stores return at once and are written by a
+// background thread, which also evicts entries by age and total size.
+
+// Time an entry was stored, looked up without reading it. Returns false if there is none.
+bool webCacheStat(const std::string &key, time_t &stored_at);
+// Reads an entry, including one still waiting to be written. Returns false if there is none.
+// The content shares the bytes of the stored entry instead of copying them.
+bool webCacheRead(const std::string &key, FileView &content, std::string *headers = nullptr);
+// Queues an entry for writing, replacing any older one and restarting its age.
+void webCacheStore(const std::string &key, std::string content, std::string headers = "");
+// Drops every entry, on disk and queued.
+void webCacheFlush();
+
+#endif // WEBCACHE_H_INCLUDED
@@ -1,18 +1,20 @@
 #include <iostream>
 #include <unistd.h>
 #include <sys/stat.h>
-//#include <mutex>
+#include <mutex>
+#include <optional>
 #include <thread>
 #include <atomic>
+#include <unordered_set>
 
 #include <curl/curl.h>
 
 #include "handler/settings.h"
 #include "handler/mihomo_fetch_client.h"
+#include "handler/webcache.h"
 #include "utils/base64/base64.h"
 #include "utils/defer.h"
 #include "utils/file_extra.h"
-#include "utils/lock.h"
 #include "utils/logger.h"
 #include "utils/urlencode.h"
 #include "version.h"
@@ -24,13 +26,6 @@
 #endif // _stat
 #endif // _WIN32
 
-/*
-using guarded_mutex = std::lock_guard<std::mutex>;
-std::mutex cache_rw_lock;
-*/
-
-RWLock cache_rw_lock;
-
 static constexpr auto user_agent_str = "subconverter/" VERSION " cURL/" LIBCURL_VERSION;
 
 std::string describeFetchTarget(const std::string &url, FetchPurpose purpose)
@@ -308,7 +303,78 @@ std::string buildSocks5ProxyString(const std::string &addr, int port, const std:
     return proxystr;
 }
 
-std::string webGet(const std::string &url, const std::string &proxy, unsigned int cache_ttl, std::string *response_headers, string_icase_map *request_headers, FetchPurpose purpose)
+std::string webCacheIdentity(const std::string &url, const std::string &proxy, const string_icase_map *request_headers, FetchPurpose purpose)
+{
+    std::string cache_identity = std::to_string(static_cast<int>(purpose)) + "\n" + url + "\n" + proxy;
+    if(purpose == FetchPurpose::SubscriptionProvider)
+        cache_identity += "\n" SUBCONVERTER_MIHOMO_COMMIT;
+    if(request_headers)
+    {
+        for(const auto &[name, value] : *request_headers)
+            cache_identity += "\n" + name + ":" + value;
+    }
+    return cache_identity;
+}
+
+/// Fetches a cached URL again and stores what came back. On 304 the cached body is kept
+/// and the new headers are appended to the cached ones.
+static int refreshCache(const std::string &key, const FetchArgument &argument, std::string &content, std::string *response_headers, const FileView *cached_content, const std::string &cached_headers)
+{
+    int return_code = 0;
+    std::string body_hash;
+    FetchResult fetch_res {&return_code, &content, response_headers, nullptr, &body_hash};
+    //content = curlGet(url, proxy, response_headers, return_code); // try to fetch data
+    FetchDispatcher::dispatch(argument, fetch_res);
+    if(return_code == 200) // success, save new cache
+    {
+        webCacheStore(key, content, response_headers ? *response_headers : cached_headers);
+    }
+    else if(return_code == 304 && cached_content)
+    {
+        writeLog(0, "Subscription content not modified. Refreshing local cache TTL.");
+        content = cached_content->str();
+        std::string headers = cached_headers;
+        if(response_headers)
+        {
+            const std::string not_modified_headers = *response_headers;
+            *response_headers = cached_headers;
+            if(!not_modified_headers.empty())
+            {
+                if(!response_headers->empty() && !endsWith(*response_headers, "\r\n"))
+                    *response_headers += "\r\n";
+                *response_headers += not_modified_headers;
+            }
+            headers = *response_headers;
+        }
+        webCacheStore(key, content, headers);
+    }
+    return return_code;
+}
+
+/// Refreshes a stale cache entry on its own thread. Only one refresh per entry runs at a time,
+/// further stale hits meanwhile keep being served from the cache.
+static void refreshCacheAsync(const std::string &key, const std::string &url, const std::string &proxy, const string_icase_map *request_headers, FetchPurpose purpose, unsigned int cache_ttl, FileView cached_content, std::string cached_headers)
+{
+    static std::mutex refresh_mutex;
+    static std::unordered_set<std::string> refreshing;
+    {
+        std::lock_guard<std::mutex> guard(refresh_mutex);
+        if(!refreshing.insert(key).second)
+            return;
+    }
+    std::thread([=, request_headers = request_headers ? std::make_optional(*request_headers) : std::nullopt, cached_content = std::move(cached_content), cached_headers = std::move(cached_headers)]
+    {
+        std::string content, response_headers, old_hash = getMD5(cached_content.view());
+        FetchArgument argument {HTTP_GET, url, proxy, nullptr, request_headers ? &*request_headers : nullptr, nullptr, cache_ttl, false, purpose, &old_hash};
+        int return_code = refreshCache(key, argument, content, &response_headers, &cached_content, cached_headers);
+        if(return_code != 200 && return_code != 304)
+            writeLog(0, "Background refresh of " + describeFetchTarget(url, purpose) + " failed, keeping stale cache.", LOG_LEVEL_WARNING);
+        std::lock_guard<std::mutex> guard(refresh_mutex);
+        refreshing.erase(key);
+    }).detach();
+}
+
+FileView webGetView(const std::string &url, const std::string &proxy, unsigned int cache_ttl, std::string *response_headers, string_icase_map *request_headers, FetchPurpose purpose)
 {
     int return_code = 0;
     std::string content, old_hash, body_hash;
@@ -317,100 +383,70 @@ std::string webGet(const std::string &url, const std::string &proxy, unsigned in
     FetchResult fetch_res {&return_code, &content, response_headers, nullptr, &body_hash};
 
     if (startsWith(url, "data:"))
-        return dataGet(url);
+        return FileView(dataGet(url));
     // cache system
     if(cache_ttl > 0)
     {
-        md("cache");
         const std::string log_target = describeFetchTarget(url, purpose);
-        std::string cache_identity = std::to_string(static_cast<int>(purpose)) + "\n" + url + "\n" + proxy;
-        if(purpose == FetchPurpose::SubscriptionProvider)
-            cache_identity += "\n" SUBCONVERTER_MIHOMO_COMMIT;
-        if(request_headers)
+        const std::string url_md5 = getMD5(webCacheIdentity(url, proxy, request_headers, purpose));
+        FileView cached_content;
+        std::string cached_headers;
+        time_t stored_at = 0;
+        bool cached = false;
+        if(webCacheStat(url_md5, stored_at)) // cache exist
         {
-            for(const auto &[name, value] : *request_headers)
-                cache_identity += "\n" + name + ":" + value;
-        }
-        const std::string url_md5 = getMD5(cache_identity);
-        const std::string path = "cache/" + url_md5, path_header = path + "_header";
-        struct stat result {};
-        if(stat(path.data(), &result) == 0) // cache exist
-        {
-            time_t mtime = result.st_mtime, now = time(nullptr); // get cache modified time and current time
-            if(difftime(now, mtime) <= cache_ttl) // within TTL
+            time_t now = time(nullptr);
+            cached = webCacheRead(url_md5, cached_content, &cached_headers);
+            if(cached && difftime(now, stored_at) <= cache_ttl) // within TTL
             {
                 writeLog(0, "CACHE HIT: " + log_target + ", using local cache.");
-                //guarded_mutex guard(cache_rw_lock);
-                cache_rw_lock.readLock();
-                defer(cache_rw_lock.readUnlock();)
                 if(response_headers)
-                    *response_headers = fileGet(path_header, true);
-                return fileGet(path, true);
+                    *response_headers = std::move(cached_headers);
+                return cached_content;
             }
-            writeLog(0, "CACHE MISS: " + log_target + ", TTL timeout, creating new cache."); // out of TTL
-            old_hash = getMD5(fileGet(path, true));
-        }
-        else
-            writeLog(0, "CACHE NOT EXIST: " + log_target + ", creating new cache.");
-        //content = curlGet(url, proxy, response_headers, return_code); // try to fetch data
-        FetchDispatcher::dispatch(argument, fetch_res);
-        if(return_code == 200) // success, save new cache
-        {
-            //guarded_mutex guard(cache_rw_lock);
-            cache_rw_lock.writeLock();
-            defer(cache_rw_lock.writeUnlock();)
-            fileWrite(path, content, true);
-            if(response_headers)
-                fileWrite(path_header, *response_headers, true);
-        }
-        else if(return_code == 304 && fileExist(path))
-        {
-            writeLog(0, "Subscription content not modified. Refreshing local cache TTL.");
-            cache_rw_lock.writeLock();
-            defer(cache_rw_lock.writeUnlock();)
-            content = fileGet(path, true);
-            fileWrite(path, content, true);
-            if(response_headers)
+            if(cached && global.cacheStaleWhileRevalidate > 0 && difftime(now, stored_at) <= cache_ttl + (double)global.cacheStaleWhileRevalidate) // within grace window
+            {
+                writeLog(0, "CACHE STALE: " + log_target + ", using local cache and refreshing it in background.");
+                if(response_headers)
+                    *response_headers = cached_headers;
+                refreshCacheAsync(url_md5, url, proxy, request_headers, purpose, cache_ttl, cached_content, std::move(cached_headers));
+                return cached_content;
+            }
+            if(cached)
             {
-                const std::string not_modified_headers = *response_headers;
-                *response_headers = fileGet(path_header, true);
-                if(!not_modified_headers.empty())
-                {
-                    if(!response_headers->empty() && !endsWith(*response_headers, "\r\n"))
-                        *response_headers += "\r\n";
-                    *response_headers += not_modified_headers;
-                    fileWrite(path_header, *response_headers, true);
-                }
+                writeLog(0, "CACHE MISS: " + log_target + ", TTL timeout, creating new cache."); // out of TTL
+                old_hash = getMD5(cached_content.view());
             }
         }
-        else
+        if(!cached)
+            writeLog(0, "CACHE NOT EXIST: " + log_target + ", creating new cache.");
+        return_code = refreshCache(url_md5, argument, content, response_headers, cached ? &cached_content : nullptr, cached_headers);
+        if(return_code != 200 && !(return_code == 304 && cached))
         {
-            if(fileExist(path) && global.serveCacheOnFetchFail) // failed, check if cache exist
+            if(cached && global.serveCacheOnFetchFail) // failed, check if cache exist
             {
                 writeLog(0, "Fetch failed. Serving cached content."); // cache exist, serving cache
-                //guarded_mutex guard(cache_rw_lock);
-                cache_rw_lock.readLock();
-                defer(cache_rw_lock.readUnlock();)
-                content = fileGet(path, true);
                 if(response_headers)
-                    *response_headers = fileGet(path_header, true);
+                    *response_headers = std::move(cached_headers);
+                return cached_content;
             }
-            else
-                writeLog(0, "Fetch failed. No local cache available."); // cache not exist or not allow to serve cache, serving nothing
+            writeLog(0, "Fetch failed. No local cache available."); // cache not exist or not allow to serve cache, serving nothing
         }
-        return content;
+        return FileView(std::move(content));
     }
     //return curlGet(url, proxy, response_headers, return_code);
     FetchDispatcher::dispatch(argument, fetch_res);
-    return content;
+    return FileView(std::move(content));
+}
+
+std::string webGet(const std::string &url, const std::string &proxy, unsigned int cache_ttl, std::string *response_headers, string_icase_map *request_headers, FetchPurpose purpose)
+{
+    return webGetView(url, proxy, cache_ttl, response_headers, request_headers, purpose).str();
 }
 
 void flushCache()
 {
-    //guarded_mutex guard(cache_rw_lock);
-    cache_rw_lock.writeLock();
-    defer(cache_rw_lock.writeUnlock();)
-    operateFiles("cache", [](const std::string &file){ remove(("cache/" + file).data()); return 0; });
+    webCacheFlush();
 }
 
 int webPost(const std::string &url, const std::string &data, const std::string &proxy, const string_icase_map &request_headers, std::string *retData)
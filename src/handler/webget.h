@@ -4,6 +4,7 @@
 #include <string>
 #include <map>
 
+#include "utils/file.h"
 #include "utils/map_extra.h"
 #include "utils/string.h"
 
@@ -51,8 +52,11 @@ public:
 };
 
 std::string describeFetchTarget(const std::string &url, FetchPurpose purpose);
+std::string webCacheIdentity(const std::string &url, const std::string &proxy, const string_icase_map *request_headers, FetchPurpose purpose);
 int webGet(const FetchArgument& argument, FetchResult &result);
 std::string webGet(const std::string &url, const std::string &proxy = "", unsigned int cache_ttl = 0, std::string *response_headers = nullptr, string_icase_map *request_headers = nullptr, FetchPurpose purpose = FetchPurpose::Generic);
+/// same as webGet(), but a cache hit shares the bytes of the cache entry instead of copying them
+FileView webGetView(const std::string &url, const std::string &proxy = "", unsigned int cache_ttl = 0, std::string *response_headers = nullptr, string_icase_map *request_headers = nullptr, FetchPurpose purpose = FetchPurpose::Generic);
 void flushCache();
 int webPost(const std::string &url, const std::string &data, const std::string &proxy, const string_icase_map &request_headers, std::string *retData);
 int webPatch(const std::string &url, const std::string &data, const std::string &proxy, const string_icase_map &request_headers, std::string *retData);
@@ -8,9 +8,11 @@
 
 #include "config/ruleset.h"
 #include "handler/interfaces.h"
+#include "handler/mihomo_fetch_client.h"
 #include "handler/webget.h"
 #include "handler/settings.h"
 #include "script/cron.h"
+#include "script/script_quickjs.h"
 #include "server/socket.h"
 #include "server/webserver.h"
 #include "utils/defer.h"
@@ -260,6 +262,51 @@ int main(int argc, char *argv[])
         return "done";
     });
 
+    webServer.append_response("GET", "/fetcherstatus", "text/plain", [](RESPONSE_CALLBACK_ARGS) -> std::string
+    {
+        if(!global.accessToken.empty())
+        {
+            std::string token = getUrlArg(request.argument, "token");
+            if(token != global.accessToken)
+            {
+                response.status_code = 403;
+                return "Forbidden\n";
+            }
+        }
+        const MihomoFetcherStats stats = mihomoFetcherStats();
+        return "pool_size=" + std::to_string(stats.pool_size) + "\n" +
+               "running=" + std::to_string(stats.running) + "\n" +
+               "in_flight=" + std::to_string(stats.in_flight) + "\n" +
+               "spare_ready=" + std::string(stats.spare_ready ? "true" : "false") + "\n" +
+               "started=" + std::to_string(stats.started) + "\n" +
+               "restarts=" + std::to_string(stats.restarts) + "\n" +
+               "start_failures=" + std::to_string(stats.start_failures) + "\n";
+    });
+
+#ifndef NO_JS_RUNTIME
+    webServer.append_response("GET", "/scriptstatus", "text/plain", [](RESPONSE_CALLBACK_ARGS) -> std::string
+    {
+        if(!global.accessToken.empty())
+        {
+            std::string token = getUrlArg(request.argument, "token");
+            if(token != global.accessToken)
+            {
+                response.status_code = 403;
+                return "Forbidden\n";
+            }
+        }
+        std::string result;
+        for(const ScriptStats &x : scriptStats())
+        {
+            result += x.name + ".runs=" + std::to_string(x.runs) + "\n" +
+                      x.name + ".total_ms=" + std::to_string(x.total_ms) + "\n" +
+                      x.name + ".max_ms=" + std::to_string(x.max_ms) + "\n" +
+                      x.name + ".timeouts=" + std::to_string(x.timeouts) + "\n";
+        }
+        return result;
+    });
+#endif // NO_JS_RUNTIME
+
     webServer.append_response("GET", "/sub", "text/plain;charset=utf-8", subconverter);
 
     webServer.append_response("HEAD", "/sub", "text/plain", subconverter);
@@ -296,6 +343,9 @@ int main(int argc, char *argv[])
     if(!env_port.empty())
         global.listenPort = to_int(env_port, global.listenPort);
     listener_args args = {global.listenAddress, global.listenPort, global.maxPendingConns, global.maxConcurThreads, cron_tick_caller, 200};
+#ifndef NO_JS_RUNTIME
+    args.worker_idle_callback = script_context_prepare;
+#endif // NO_JS_RUNTIME
     //std::cout<<"Serving HTTP @ http://"<<listen_address<<":"<<listen_port<<std::endl;
     writeLog(0, "Startup completed. Serving HTTP @ http://" + global.listenAddress + ":" + std::to_string(global.listenPort), LOG_LEVEL_INFO);
     webServer.start_web_server_multi(&args);
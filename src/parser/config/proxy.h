@@ -152,6 +152,9 @@ struct Proxy {
     StringMap XHTTPOptions;
 };
 
+/// non-owning view over nodes kept by a generator, avoids deep-copying every Proxy
+using ProxyRefs = std::vector<const Proxy *>;
+
 #define SS_DEFAULT_GROUP "SSProvider"
 #define SSR_DEFAULT_GROUP "SSRProvider"
 #define V2RAY_DEFAULT_GROUP "V2RayProvider"
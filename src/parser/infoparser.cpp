@@ -1,5 +1,6 @@
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <cmath>
 #include <ctime>
 
@@ -83,49 +84,35 @@ bool getSubInfoFromHeader(const std::string &header, std::string &result)
     return false;
 }
 
-bool getSubInfoFromNodes(const std::vector<Proxy> &nodes, const RegexMatchConfigs &stream_rules, const RegexMatchConfigs &time_rules, std::string &result)
-{
-    std::string remarks, stream_info, time_info, retStr;
+/// providers put their info nodes at the top of the list, no need to look at every node
+static constexpr size_t info_node_scan_limit = 32;
 
-    for(const Proxy &x : nodes)
+static bool findInfo(const std::string &remarks, const RegexReplacers &rules, std::string &info)
+{
+    std::string retStr;
+    for(const RegexReplacer &y : rules)
     {
-        remarks = x.Remark;
-        if(stream_info.empty())
+        if(y.matchReplace(remarks, retStr) && retStr != remarks)
         {
-            for(const RegexMatchConfig &y : stream_rules)
-            {
-                if(regMatch(remarks, y.Match))
-                {
-                    retStr = regReplace(remarks, y.Match, y.Replace);
-                    if(retStr != remarks)
-                    {
-                        stream_info = retStr;
-                        break;
-                    }
-                }
-                else
-                    continue;
-            }
+            info = std::move(retStr);
+            return true;
         }
+    }
+    return false;
+}
 
-        remarks = x.Remark;
+bool getSubInfoFromNodes(const std::vector<Proxy> &nodes, const RegexReplacers &stream_rules, const RegexReplacers &time_rules, std::string &result)
+{
+    std::string stream_info, time_info;
+
+    size_t scan_count = std::min(nodes.size(), info_node_scan_limit);
+    for(size_t i = 0; i < scan_count; i++)
+    {
+        const std::string &remarks = nodes[i].Remark;
+        if(stream_info.empty())
+            findInfo(remarks, stream_rules, stream_info);
         if(time_info.empty())
-        {
-            for(const RegexMatchConfig &y : time_rules)
-            {
-                if(regMatch(remarks, y.Match))
-                {
-                    retStr = regReplace(remarks, y.Match, y.Replace);
-                    if(retStr != remarks)
-                    {
-                        time_info = retStr;
-                        break;
-                    }
-                }
-                else
-                    continue;
-            }
-        }
+            findInfo(remarks, time_rules, time_info);
 
         if(!stream_info.empty() && !time_info.empty())
             break;
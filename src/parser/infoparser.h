@@ -6,9 +6,10 @@
 #include "utils/string.h"
 #include "config/proxy.h"
 #include "config/regmatch.h"
+#include "utils/regexp.h"
 
 bool getSubInfoFromHeader(const std::string &header, std::string &result);
-bool getSubInfoFromNodes(const std::vector<Proxy> &nodes, const RegexMatchConfigs &stream_rules, const RegexMatchConfigs &time_rules, std::string &result);
+bool getSubInfoFromNodes(const std::vector<Proxy> &nodes, const RegexReplacers &stream_rules, const RegexReplacers &time_rules, std::string &result);
 bool getSubInfoFromSSD(const std::string &sub, std::string &result);
 unsigned long long streamToInt(const std::string &stream);
 
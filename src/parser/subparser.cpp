@@ -1,5 +1,13 @@
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <istream>
 #include <string>
 #include <map>
+#include <optional>
+#include <thread>
+
+#include <yaml-cpp/eventhandler.h>
 
 #include "utils/base64/base64.h"
 #include "utils/ini_reader/ini_reader.h"
@@ -102,8 +110,8 @@ std::string jsonScalarToString(const rapidjson::Value &value) {
     return "";
 }
 
-void readXHTTPExtraOptions(const std::string &addition, Proxy &node) {
-    std::string extra = urlDecode(getUrlArg(addition, "extra"));
+void readXHTTPExtraOptions(const UrlArgs &args, Proxy &node) {
+    std::string extra = urlDecode(args.get("extra"));
     if (extra.empty())
         return;
 
@@ -147,9 +155,9 @@ void extractRemark(std::string &link, std::string &remark) {
     }
 }
 
-std::vector<std::string> getUrlAlpnList(const std::string &addition) {
+std::vector<std::string> getUrlAlpnList(const UrlArgs &args) {
     std::vector<std::string> result;
-    std::string alpn = urlDecode(getUrlArg(addition, "alpn"));
+    std::string alpn = urlDecode(args.get("alpn"));
     if (alpn.empty())
         return result;
 
@@ -162,8 +170,8 @@ std::vector<std::string> getUrlAlpnList(const std::string &addition) {
     return result;
 }
 
-std::string getUrlAlpn(const std::string &addition) {
-    return join(getUrlAlpnList(addition), ",");
+std::string getUrlAlpn(const UrlArgs &args) {
+    return join(getUrlAlpnList(args), ",");
 }
 
 void commonConstruct(Proxy &node, ProxyType type, const std::string &group, const std::string &remarks,
@@ -443,19 +451,36 @@ void tuicConstruct(Proxy &node, const std::string &group, const std::string &rem
 }
 
 
+/// same as regMatch(link, scheme + "(.*?)" + separator + "(.*)"): the link starts with the scheme,
+/// has the separator after it and is a single line
+static bool linkHasSeparator(std::string_view link, std::string_view scheme, char separator) {
+    return link.starts_with(scheme) && link.find(separator, scheme.size()) != std::string_view::npos &&
+           link.find('\n') == std::string_view::npos;
+}
+
+/// same as regMatch(link, "vmess://([A-Za-z0-9-_]+)\\?(.*)")
+static bool isShadowrocketVmess(std::string_view link) {
+    if (!link.starts_with("vmess://"))
+        return false;
+    string_size pos = 8;
+    while (pos < link.size() && (isalnum((unsigned char) link[pos]) || link[pos] == '-' || link[pos] == '_'))
+        pos++;
+    return pos > 8 && pos < link.size() && link[pos] == '?' && link.find('\n', pos) == std::string_view::npos;
+}
+
 void explodeVmess(std::string vmess, Proxy &node) {
     std::string version, ps, add, port, type, id, aid, net, path, host, tls, sni;
     Document jsondata;
     std::vector<std::string> vArray;
 
-    if (regMatch(vmess, "vmess://([A-Za-z0-9-_]+)\\?(.*)")) //shadowrocket style link
+    if (isShadowrocketVmess(vmess)) //shadowrocket style link
     {
         explodeShadowrocket(vmess, node);
         return;
-    } else if (regMatch(vmess, "vmess://(.*?)@(.*)")) {
+    } else if (linkHasSeparator(vmess, "vmess://", '@')) {
         explodeStdVMess(vmess, node);
         return;
-    } else if (regMatch(vmess, "vmess1://(.*?)\\?(.*)")) //kitsunebi style link
+    } else if (linkHasSeparator(vmess, "vmess1://", '?')) //kitsunebi style link
     {
         explodeKitsunebi(vmess, node);
         return;
@@ -832,10 +857,11 @@ void explodeSSR(std::string ssr, Proxy &node) {
     if (strFind(ssr, "/?")) {
         strobfs = ssr.substr(ssr.find("/?") + 2);
         ssr = ssr.substr(0, ssr.find("/?"));
-        group = urlSafeBase64Decode(getUrlArg(strobfs, "group"));
-        remarks = urlSafeBase64Decode(getUrlArg(strobfs, "remarks"));
-        obfsparam = regReplace(urlSafeBase64Decode(getUrlArg(strobfs, "obfsparam")), "\\s", "");
-        protoparam = regReplace(urlSafeBase64Decode(getUrlArg(strobfs, "protoparam")), "\\s", "");
+        UrlArgs args(strobfs);
+        group = urlSafeBase64Decode(args.get("group"));
+        remarks = urlSafeBase64Decode(args.get("remarks"));
+        obfsparam = regReplace(urlSafeBase64Decode(args.get("obfsparam")), "\\s", "");
+        protoparam = regReplace(urlSafeBase64Decode(args.get("protoparam")), "\\s", "");
     }
 
     if (regGetMatch(ssr, "(\\S+):(\\d+?):(\\S+?):(\\S+?):(\\S+?):(\\S+)", 7, 0, &server, &port, &protocol, &method,
@@ -948,12 +974,13 @@ void explodeSocks(std::string link, Proxy &node) {
         port = arguments[1];
     } else if (strFind(link, "https://t.me/socks") || strFind(link, "tg://socks")) //telegram style socks link
     {
-        server = getUrlArg(link, "server");
-        port = getUrlArg(link, "port");
-        username = urlDecode(getUrlArg(link, "user"));
-        password = urlDecode(getUrlArg(link, "pass"));
-        remarks = urlDecode(getUrlArg(link, "remarks"));
-        group = urlDecode(getUrlArg(link, "group"));
+        UrlArgs args(link);
+        server = args.get("server");
+        port = args.get("port");
+        username = urlDecode(args.get("user"));
+        password = urlDecode(args.get("pass"));
+        remarks = urlDecode(args.get("remarks"));
+        group = urlDecode(args.get("group"));
     }
     if (group.empty())
         group = SOCKS_DEFAULT_GROUP;
@@ -967,12 +994,13 @@ void explodeSocks(std::string link, Proxy &node) {
 
 void explodeHTTP(const std::string &link, Proxy &node) {
     std::string group, remarks, server, port, username, password;
-    server = getUrlArg(link, "server");
-    port = getUrlArg(link, "port");
-    username = urlDecode(getUrlArg(link, "user"));
-    password = urlDecode(getUrlArg(link, "pass"));
-    remarks = urlDecode(getUrlArg(link, "remarks"));
-    group = urlDecode(getUrlArg(link, "group"));
+    UrlArgs args(link);
+    server = args.get("server");
+    port = args.get("port");
+    username = urlDecode(args.get("user"));
+    password = urlDecode(args.get("pass"));
+    remarks = urlDecode(args.get("remarks"));
+    group = urlDecode(args.get("group"));
 
     if (group.empty())
         group = HTTP_DEFAULT_GROUP;
@@ -1032,38 +1060,44 @@ void explodeTrojan(std::string trojan, Proxy &node) {
         trojan.erase(pos);
     }
 
-    if (regGetMatch(trojan, "(.*?)@(.*):(.*)", 4, 0, &psk, &server, &port))
+    /// psk runs to the first '@', the port follows the last ':'
+    string_size at = trojan.find('@'), colon = trojan.rfind(':');
+    if (at == std::string::npos || colon == std::string::npos || colon < at || trojan.find('\n') != std::string::npos)
         return;
+    psk = trojan.substr(0, at);
+    server = trojan.substr(at + 1, colon - at - 1);
+    port = trojan.substr(colon + 1);
     if (port == "0")
         return;
 
-    host = getUrlArg(addition, "sni");
-    sni = getUrlArg(addition, "sni");
-    host = getUrlArg(addition, "host");
+    UrlArgs args(addition);
+    host = args.get("sni");
+    sni = args.get("sni");
+    host = args.get("host");
     if (host.empty())
         host = sni;
     if (host.empty())
-        host = getUrlArg(addition, "peer");
-    tfo = getUrlArg(addition, "tfo");
-    fp = getUrlArg(addition, "fp");
-    scv = getUrlArg(addition, "allowInsecure");
-    group = urlDecode(getUrlArg(addition, "group"));
-
-    if (getUrlArg(addition, "ws") == "1") {
-        path = getUrlArg(addition, "wspath");
+        host = args.get("peer");
+    tfo = args.get("tfo");
+    fp = args.get("fp");
+    scv = args.get("allowInsecure");
+    group = urlDecode(args.get("group"));
+
+    if (args.get("ws") == "1") {
+        path = args.get("wspath");
         network = "ws";
     }
     // support the trojan link format used by v2ryaN and X-ui.
     // format: trojan://{password}@{server}:{port}?type=ws&security=tls&path={path (urlencoded)}&sni={host}#{name}
-    else if (getUrlArg(addition, "type") == "ws") {
-        path = getUrlArg(addition, "path");
+    else if (args.get("type") == "ws") {
+        path = args.get("path");
         if (path.substr(0, 3) == "%2F")
             path = urlDecode(path);
         network = "ws";
     }
 
-    else if (getUrlArg(addition, "type") == "grpc") {  
-        path = getUrlArg(addition, "serviceName");  
+    else if (args.get("type") == "grpc") {  
+        path = args.get("serviceName");  
         network = "grpc";  
     }
     
@@ -1071,13 +1105,13 @@ void explodeTrojan(std::string trojan, Proxy &node) {
         remark = server + ":" + port;
     if (group.empty())
         group = TROJAN_DEFAULT_GROUP;
-    std::vector<std::string> alpnList = getUrlAlpnList(addition);
+    std::vector<std::string> alpnList = getUrlAlpnList(args);
     trojanConstruct(node, group, remark, server, port, psk, network, host, path, fp, sni, alpnList, true, tribool(),
                     tfo, scv);
 }
 
 void explodeVless(std::string vless, Proxy &node) {
-    if (regMatch(vless, "vless://(.*?)@(.*)")) {
+    if (linkHasSeparator(vless, "vless://", '@')) {
         explodeStdVless(vless, node);
         return;
     }
@@ -1085,14 +1119,14 @@ void explodeVless(std::string vless, Proxy &node) {
 
 void explodeMierus(std::string mierus, Proxy &node) {
     if (strFind(mierus, "mierus://")) {
-        if (regMatch(mierus, "mierus://(.*?)@(.*)")) {
+        if (linkHasSeparator(mierus, "mierus://", '@')) {
             explodeStdMieru(mierus.substr(9), node);
         } else {
             mierus = urlSafeBase64Decode(mierus.substr(9));
             explodeStdMieru("mierus://" + mierus, node);
         }
     } else if (strFind(mierus, "mieru://")) {
-        if (regMatch(mierus, "mierus://(.*?)@(.*)")) {
+        if (linkHasSeparator(mierus, "mierus://", '@')) {
             explodeStdMieru(mierus.substr(8), node);
         } else {
             mierus = urlSafeBase64Decode(mierus.substr(8));
@@ -1102,9 +1136,8 @@ void explodeMierus(std::string mierus, Proxy &node) {
 }
 
 void explodeHysteria(std::string hysteria, Proxy &node) {
-    printf("explodeHysteria\n");
     hysteria = regReplace(hysteria, "(hysteria|hy)://", "hysteria://");
-    if (regMatch(hysteria, "hysteria://(.*?)[:](.*)")) {
+    if (linkHasSeparator(hysteria, "hysteria://", ':')) {
         explodeStdHysteria(hysteria, node);
         return;
     }
@@ -1115,7 +1148,7 @@ void explodeHysteria2(std::string hysteria2, Proxy &node) {
 
     // replace /? with ?
     hysteria2 = regReplace(hysteria2, "/\\?", "?", true, false);
-    if (regMatch(hysteria2, "hysteria2://(.*?)[:](.*)")) {
+    if (linkHasSeparator(hysteria2, "hysteria2://", ':')) {
         explodeStdHysteria2(hysteria2, node);
         return;
     }
@@ -1291,449 +1324,452 @@ void explodeNetch(std::string netch, Proxy &node) {
     }
 }
 
-void explodeClash(Node yamlnode, std::vector<Proxy> &nodes) {
-    Node singleproxy;
-    uint32_t index = nodes.size();
-    const std::string section = yamlnode["proxies"].IsDefined() ? "proxies" : "Proxy";
-    for (uint32_t i = 0; i < yamlnode[section].size(); i++) {
-        std::string proxytype, ps, server, port, cipher, group, password = "", ports, tempPassword; //common
-        std::string type = "none", id, aid = "0", net = "tcp", path, host, edge, tls, sni; //vmess
-        std::string fp = "chrome", pbk, sid, packet_encoding, encryption; //vless
-        std::string plugin, pluginopts, pluginopts_mode, pluginopts_host, pluginopts_mux; //ss
-        std::string protocol, protoparam, obfs, obfsparam; //ssr
-        std::string flow, mode; //trojan
-        std::string user; //socks
-        std::string ip, ipv6, private_key, public_key, mtu; //wireguard
-        std::string auth, up, down, obfsParam, insecure, alpn; //hysteria
-        std::string obfsPassword; //hysteria2
-        std::string congestion_control, udp_relay_mode, token; // tuic
-        std::string underlying_proxy;
-        string_array dns_server;
-        std::vector<String> alpns;
-        String alpn2;
-        std::string fingerprint, multiplexing, transfer_protocol, v2ray_http_upgrade;
-        tribool udp, tfo, scv;
-        bool reduceRtt, disableSni; //tuic
-        std::vector<std::string> alpnList;
-        Proxy node;
-        singleproxy = yamlnode[section][i];
-        singleproxy["type"] >>= proxytype;
-        singleproxy["name"] >>= ps;
-        singleproxy["server"] >>= server;
-        singleproxy["port"] >>= port;
-        singleproxy["port-range"] >>= ports;
-
-        if (port.empty() || port == "0")
-            if (ports.empty())
-                continue;
-        udp = safe_as<std::string>(singleproxy["udp"]);
-        scv = safe_as<std::string>(singleproxy["skip-cert-verify"]);
-        singleproxy["dialer-proxy"] >>= underlying_proxy;
-        switch (hash_(proxytype)) {
-            case "vmess"_hash:
-                singleproxy["uuid"] >>= id;
-                if (id.length() < 36) {
+static bool explodeClashProxy(const Node &singleproxy, Proxy &node) {
+    std::string proxytype, ps, server, port, cipher, group, password = "", ports, tempPassword; //common
+    std::string type = "none", id, aid = "0", net = "tcp", path, host, edge, tls, sni; //vmess
+    std::string fp = "chrome", pbk, sid, packet_encoding, encryption; //vless
+    std::string plugin, pluginopts, pluginopts_mode, pluginopts_host, pluginopts_mux; //ss
+    std::string protocol, protoparam, obfs, obfsparam; //ssr
+    std::string flow, mode; //trojan
+    std::string user; //socks
+    std::string ip, ipv6, private_key, public_key, mtu; //wireguard
+    std::string auth, up, down, obfsParam, insecure, alpn; //hysteria
+    std::string obfsPassword; //hysteria2
+    std::string congestion_control, udp_relay_mode, token; // tuic
+    std::string underlying_proxy;
+    string_array dns_server;
+    std::vector<String> alpns;
+    String alpn2;
+    std::string fingerprint, multiplexing, transfer_protocol, v2ray_http_upgrade;
+    tribool udp, tfo, scv;
+    bool reduceRtt, disableSni; //tuic
+    std::vector<std::string> alpnList;
+    singleproxy["type"] >>= proxytype;
+    singleproxy["name"] >>= ps;
+    singleproxy["server"] >>= server;
+    singleproxy["port"] >>= port;
+    singleproxy["port-range"] >>= ports;
+
+    if (port.empty() || port == "0")
+        if (ports.empty())
+            return false;
+    udp = safe_as<std::string>(singleproxy["udp"]);
+    scv = safe_as<std::string>(singleproxy["skip-cert-verify"]);
+    singleproxy["dialer-proxy"] >>= underlying_proxy;
+    switch (hash_(proxytype)) {
+        case "vmess"_hash:
+            singleproxy["uuid"] >>= id;
+            if (id.length() < 36) {
+                break;
+            }
+            group = V2RAY_DEFAULT_GROUP;
+            singleproxy["alterId"] >>= aid;
+            singleproxy["cipher"] >>= cipher;
+            net = singleproxy["network"].IsDefined() ? safe_as<std::string>(singleproxy["network"]) : "tcp";
+            singleproxy["servername"] >>= sni;
+            switch (hash_(net)) {
+                case "http"_hash:
+                    singleproxy["http-opts"]["path"][0] >>= path;
+                    singleproxy["http-opts"]["headers"]["Host"][0] >>= host;
+                    edge.clear();
                     break;
-                }
-                group = V2RAY_DEFAULT_GROUP;
-                singleproxy["alterId"] >>= aid;
-                singleproxy["cipher"] >>= cipher;
-                net = singleproxy["network"].IsDefined() ? safe_as<std::string>(singleproxy["network"]) : "tcp";
-                singleproxy["servername"] >>= sni;
-                switch (hash_(net)) {
-                    case "http"_hash:
-                        singleproxy["http-opts"]["path"][0] >>= path;
-                        singleproxy["http-opts"]["headers"]["Host"][0] >>= host;
-                        edge.clear();
-                        break;
-                    case "ws"_hash:
-                        if (singleproxy["ws-opts"].IsDefined()) {
-                            path = singleproxy["ws-opts"]["path"].IsDefined()
-                                       ? safe_as<std::string>(
-                                           singleproxy["ws-opts"]["path"])
-                                       : "/";
-                            singleproxy["ws-opts"]["headers"]["Host"] >>= host;
-                            if (host.empty()) {
-                                singleproxy["ws-opts"]["headers"]["host"] >>= host;
-                            }
-                            singleproxy["ws-opts"]["headers"]["Edge"] >>= edge;
-                        } else {
-                            path = singleproxy["ws-path"].IsDefined()
-                                       ? safe_as<std::string>(singleproxy["ws-path"])
-                                       : "/";
-                            singleproxy["ws-headers"]["Host"] >>= host;
-                            singleproxy["ws-headers"]["Edge"] >>= edge;
+                case "ws"_hash:
+                    if (singleproxy["ws-opts"].IsDefined()) {
+                        path = singleproxy["ws-opts"]["path"].IsDefined()
+                                   ? safe_as<std::string>(
+                                       singleproxy["ws-opts"]["path"])
+                                   : "/";
+                        singleproxy["ws-opts"]["headers"]["Host"] >>= host;
+                        if (host.empty()) {
+                            singleproxy["ws-opts"]["headers"]["host"] >>= host;
                         }
-                        break;
-                    case "h2"_hash:
-                        singleproxy["h2-opts"]["path"] >>= path;
-                        singleproxy["h2-opts"]["host"][0] >>= host;
-                        edge.clear();
-                        break;
-                    case "grpc"_hash:
-                        singleproxy["servername"] >>= host;
-                        singleproxy["grpc-opts"]["grpc-service-name"] >>= path;
-                        edge.clear();
-                        break;
-                }
-                tls = safe_as<std::string>(singleproxy["tls"]) == "true" ? "tls" : "";
-                singleproxy["alpn"] >>= alpnList;
-                vmessConstruct(node, group, ps, server, port, "", id, aid, net, cipher, path, host, edge, tls, sni,
-                               alpnList, udp,
-                               tfo, scv, tribool(), underlying_proxy);
-                break;
-            case "ss"_hash:
-                group = SS_DEFAULT_GROUP;
-
-                singleproxy["cipher"] >>= cipher;
-                singleproxy["password"] >>= password;
-                if (singleproxy["plugin"].IsDefined()) {
-                    switch (hash_(safe_as<std::string>(singleproxy["plugin"]))) {
-                        case "obfs"_hash:
-                            plugin = "obfs-local";
-                            if (singleproxy["plugin-opts"].IsDefined()) {
-                                singleproxy["plugin-opts"]["mode"] >>= pluginopts_mode;
-                                singleproxy["plugin-opts"]["host"] >>= pluginopts_host;
-                            }
-                            break;
-                        case "v2ray-plugin"_hash:
-                            plugin = "v2ray-plugin";
-                            if (singleproxy["plugin-opts"].IsDefined()) {
-                                singleproxy["plugin-opts"]["mode"] >>= pluginopts_mode;
-                                singleproxy["plugin-opts"]["host"] >>= pluginopts_host;
-                                tls = safe_as<bool>(singleproxy["plugin-opts"]["tls"]) ? "tls;" : "";
-                                singleproxy["plugin-opts"]["path"] >>= path;
-                                pluginopts_mux = safe_as<bool>(singleproxy["plugin-opts"]["mux"]) ? "4" : "";
-                            }
-                            break;
-                        default:
-                            break;
+                        singleproxy["ws-opts"]["headers"]["Edge"] >>= edge;
+                    } else {
+                        path = singleproxy["ws-path"].IsDefined()
+                                   ? safe_as<std::string>(singleproxy["ws-path"])
+                                   : "/";
+                        singleproxy["ws-headers"]["Host"] >>= host;
+                        singleproxy["ws-headers"]["Edge"] >>= edge;
                     }
-                } else if (singleproxy["obfs"].IsDefined()) {
-                    plugin = "obfs-local";
-                    singleproxy["obfs"] >>= pluginopts_mode;
-                    singleproxy["obfs-host"] >>= pluginopts_host;
-                } else
-                    plugin.clear();
-
-                switch (hash_(plugin)) {
-                    case "simple-obfs"_hash:
-                    case "obfs-local"_hash:
-                        pluginopts = "obfs=" + pluginopts_mode;
-                        pluginopts += pluginopts_host.empty() ? "" : ";obfs-host=" + pluginopts_host;
+                    break;
+                case "h2"_hash:
+                    singleproxy["h2-opts"]["path"] >>= path;
+                    singleproxy["h2-opts"]["host"][0] >>= host;
+                    edge.clear();
+                    break;
+                case "grpc"_hash:
+                    singleproxy["servername"] >>= host;
+                    singleproxy["grpc-opts"]["grpc-service-name"] >>= path;
+                    edge.clear();
+                    break;
+            }
+            tls = safe_as<std::string>(singleproxy["tls"]) == "true" ? "tls" : "";
+            singleproxy["alpn"] >>= alpnList;
+            vmessConstruct(node, group, ps, server, port, "", id, aid, net, cipher, path, host, edge, tls, sni,
+                           alpnList, udp,
+                           tfo, scv, tribool(), underlying_proxy);
+            break;
+        case "ss"_hash:
+            group = SS_DEFAULT_GROUP;
+
+            singleproxy["cipher"] >>= cipher;
+            singleproxy["password"] >>= password;
+            if (singleproxy["plugin"].IsDefined()) {
+                switch (hash_(safe_as<std::string>(singleproxy["plugin"]))) {
+                    case "obfs"_hash:
+                        plugin = "obfs-local";
+                        if (singleproxy["plugin-opts"].IsDefined()) {
+                            singleproxy["plugin-opts"]["mode"] >>= pluginopts_mode;
+                            singleproxy["plugin-opts"]["host"] >>= pluginopts_host;
+                        }
                         break;
                     case "v2ray-plugin"_hash:
-                        pluginopts = "mode=" + pluginopts_mode + ";" + tls;
-                        if (!pluginopts_host.empty())
-                            pluginopts += "host=" + pluginopts_host + ";";
-                        if (!path.empty())
-                            pluginopts += "path=" + path + ";";
-                        if (!pluginopts_mux.empty())
-                            pluginopts += "mux=" + pluginopts_mux + ";";
+                        plugin = "v2ray-plugin";
+                        if (singleproxy["plugin-opts"].IsDefined()) {
+                            singleproxy["plugin-opts"]["mode"] >>= pluginopts_mode;
+                            singleproxy["plugin-opts"]["host"] >>= pluginopts_host;
+                            tls = safe_as<bool>(singleproxy["plugin-opts"]["tls"]) ? "tls;" : "";
+                            singleproxy["plugin-opts"]["path"] >>= path;
+                            pluginopts_mux = safe_as<bool>(singleproxy["plugin-opts"]["mux"]) ? "4" : "";
+                        }
+                        break;
+                    default:
                         break;
                 }
+            } else if (singleproxy["obfs"].IsDefined()) {
+                plugin = "obfs-local";
+                singleproxy["obfs"] >>= pluginopts_mode;
+                singleproxy["obfs-host"] >>= pluginopts_host;
+            } else
+                plugin.clear();
+
+            switch (hash_(plugin)) {
+                case "simple-obfs"_hash:
+                case "obfs-local"_hash:
+                    pluginopts = "obfs=" + pluginopts_mode;
+                    pluginopts += pluginopts_host.empty() ? "" : ";obfs-host=" + pluginopts_host;
+                    break;
+                case "v2ray-plugin"_hash:
+                    pluginopts = "mode=" + pluginopts_mode + ";" + tls;
+                    if (!pluginopts_host.empty())
+                        pluginopts += "host=" + pluginopts_host + ";";
+                    if (!path.empty())
+                        pluginopts += "path=" + path + ";";
+                    if (!pluginopts_mux.empty())
+                        pluginopts += "mux=" + pluginopts_mux + ";";
+                    break;
+            }
 
-            //support for go-shadowsocks2
-                if (cipher == "AEAD_CHACHA20_POLY1305")
-                    cipher = "chacha20-ietf-poly1305";
-                else if (strFind(cipher, "AEAD")) {
-                    cipher = replaceAllDistinct(replaceAllDistinct(cipher, "AEAD_", ""), "_", "-");
-                    std::transform(cipher.begin(), cipher.end(), cipher.begin(), ::tolower);
-                }
+        //support for go-shadowsocks2
+            if (cipher == "AEAD_CHACHA20_POLY1305")
+                cipher = "chacha20-ietf-poly1305";
+            else if (strFind(cipher, "AEAD")) {
+                cipher = replaceAllDistinct(replaceAllDistinct(cipher, "AEAD_", ""), "_", "-");
+                std::transform(cipher.begin(), cipher.end(), cipher.begin(), ::tolower);
+            }
 
-                ssConstruct(node, group, ps, server, port, password, cipher, plugin, pluginopts, udp, tfo, scv,
-                            tribool(), underlying_proxy);
-                break;
-            case "socks5"_hash:
-                group = SOCKS_DEFAULT_GROUP;
+            ssConstruct(node, group, ps, server, port, password, cipher, plugin, pluginopts, udp, tfo, scv,
+                        tribool(), underlying_proxy);
+            break;
+        case "socks5"_hash:
+            group = SOCKS_DEFAULT_GROUP;
 
-                singleproxy["username"] >>= user;
-                singleproxy["password"] >>= password;
+            singleproxy["username"] >>= user;
+            singleproxy["password"] >>= password;
 
-                socksConstruct(node, group, ps, server, port, user, password, tribool(), tribool(), tribool(),
-                               underlying_proxy);
-                break;
-            case "ssr"_hash:
-                group = SSR_DEFAULT_GROUP;
-
-                singleproxy["cipher"] >>= cipher;
-                if (cipher == "dummy") cipher = "none";
-                singleproxy["password"] >>= password;
-                singleproxy["protocol"] >>= protocol;
-                singleproxy["obfs"] >>= obfs;
-                if (singleproxy["protocol-param"].IsDefined())
-                    singleproxy["protocol-param"] >>= protoparam;
-                else
-                    singleproxy["protocolparam"] >>= protoparam;
-                if (singleproxy["obfs-param"].IsDefined())
-                    singleproxy["obfs-param"] >>= obfsparam;
-                else
-                    singleproxy["obfsparam"] >>= obfsparam;
+            socksConstruct(node, group, ps, server, port, user, password, tribool(), tribool(), tribool(),
+                           underlying_proxy);
+            break;
+        case "ssr"_hash:
+            group = SSR_DEFAULT_GROUP;
 
-                ssrConstruct(node, group, ps, server, port, protocol, cipher, obfs, password, obfsparam, protoparam,
-                             udp, tfo, scv, underlying_proxy);
-                break;
-            case "http"_hash:
-                group = HTTP_DEFAULT_GROUP;
+            singleproxy["cipher"] >>= cipher;
+            if (cipher == "dummy") cipher = "none";
+            singleproxy["password"] >>= password;
+            singleproxy["protocol"] >>= protocol;
+            singleproxy["obfs"] >>= obfs;
+            if (singleproxy["protocol-param"].IsDefined())
+                singleproxy["protocol-param"] >>= protoparam;
+            else
+                singleproxy["protocolparam"] >>= protoparam;
+            if (singleproxy["obfs-param"].IsDefined())
+                singleproxy["obfs-param"] >>= obfsparam;
+            else
+                singleproxy["obfsparam"] >>= obfsparam;
+
+            ssrConstruct(node, group, ps, server, port, protocol, cipher, obfs, password, obfsparam, protoparam,
+                         udp, tfo, scv, underlying_proxy);
+            break;
+        case "http"_hash:
+            group = HTTP_DEFAULT_GROUP;
 
-                singleproxy["username"] >>= user;
-                singleproxy["password"] >>= password;
-                singleproxy["tls"] >>= tls;
+            singleproxy["username"] >>= user;
+            singleproxy["password"] >>= password;
+            singleproxy["tls"] >>= tls;
 
-                httpConstruct(node, group, ps, server, port, user, password, tls == "true", tfo, scv, tribool(),
-                              underlying_proxy);
-                break;
-            case "trojan"_hash:
-                group = TROJAN_DEFAULT_GROUP;
-                singleproxy["password"] >>= password;
-                singleproxy["sni"] >>= host;
-                singleproxy["sni"] >>= sni;
-                singleproxy["network"] >>= net;
-                switch (hash_(net)) {
-                    case "grpc"_hash:
-                        singleproxy["grpc-opts"]["grpc-service-name"] >>= path;
-                        break;
-                    case "ws"_hash:
-                        singleproxy["ws-opts"]["path"] >>= path;
-                        break;
-                    default:
-                        net = "tcp";
-                        path.clear();
-                        break;
-                }
-                singleproxy["alpn"] >>= alpnList;
-
-                trojanConstruct(node, group, ps, server, port, password, net, host, path, fp, sni, alpnList, true,
-                                udp, tfo, scv, tribool(), underlying_proxy);
-                break;
-            case "snell"_hash:
-                group = SNELL_DEFAULT_GROUP;
-                singleproxy["psk"] >> password;
-                singleproxy["obfs-opts"]["mode"] >>= obfs;
-                singleproxy["obfs-opts"]["host"] >>= host;
-                singleproxy["version"] >>= aid;
-
-                snellConstruct(node, group, ps, server, port, password, obfs, host, to_int(aid, 0), udp, tfo, scv,
-                               underlying_proxy);
-                break;
-            case "wireguard"_hash:
-                group = WG_DEFAULT_GROUP;
-                singleproxy["public-key"] >>= public_key;
-                singleproxy["private-key"] >>= private_key;
-                singleproxy["dns"] >>= dns_server;
-                singleproxy["mtu"] >>= mtu;
-                singleproxy["preshared-key"] >>= password;
-                singleproxy["ip"] >>= ip;
-                singleproxy["ipv6"] >>= ipv6;
-
-                wireguardConstruct(node, group, ps, server, port, ip, ipv6, private_key, public_key, password,
-                                   dns_server, mtu, "0", "", "", udp, underlying_proxy);
-                break;
-            case "vless"_hash:
-                group = XRAY_DEFAULT_GROUP;
-                singleproxy["uuid"] >>= id;
-                singleproxy["alterId"] >>= aid;
-                net = singleproxy["network"].IsDefined() ? safe_as<std::string>(singleproxy["network"]) : "tcp";
-                sni = singleproxy["sni"].IsDefined()
-                          ? safe_as<std::string>(singleproxy["sni"])
-                          : safe_as<std::string>(
-                              singleproxy["servername"]);
-                switch (hash_(net)) {
-                    case "tcp"_hash:
-                    case "http"_hash:
-                        singleproxy["http-opts"]["path"][0] >>= path;
-                        singleproxy["http-opts"]["headers"]["Host"][0] >>= host;
-                        edge.clear();
-                        break;
-                    case "ws"_hash:
-                        if (singleproxy["ws-opts"].IsDefined()) {
-                            path = singleproxy["ws-opts"]["path"].IsDefined()
-                                       ? safe_as<std::string>(
-                                           singleproxy["ws-opts"]["path"])
-                                       : "/";
-                            singleproxy["ws-opts"]["headers"]["Host"] >>= host;
-                            if (host.empty()) {
-                                singleproxy["ws-opts"]["headers"]["host"] >>= host;
-                            }
-                            singleproxy["ws-opts"]["headers"]["Edge"] >>= edge;
-                            if (singleproxy["ws-opts"]["v2ray-http-upgrade"].IsDefined()) {
-                                v2ray_http_upgrade = safe_as<std::string>(singleproxy["ws-opts"]["v2ray-http-upgrade"]);
-                            }
-                        } else {
-                            path = singleproxy["ws-path"].IsDefined()
-                                       ? safe_as<std::string>(singleproxy["ws-path"])
-                                       : "/";
-                            singleproxy["ws-headers"]["Host"] >>= host;
-                            singleproxy["ws-headers"]["Edge"] >>= edge;
-                        }
+            httpConstruct(node, group, ps, server, port, user, password, tls == "true", tfo, scv, tribool(),
+                          underlying_proxy);
+            break;
+        case "trojan"_hash:
+            group = TROJAN_DEFAULT_GROUP;
+            singleproxy["password"] >>= password;
+            singleproxy["sni"] >>= host;
+            singleproxy["sni"] >>= sni;
+            singleproxy["network"] >>= net;
+            switch (hash_(net)) {
+                case "grpc"_hash:
+                    singleproxy["grpc-opts"]["grpc-service-name"] >>= path;
+                    break;
+                case "ws"_hash:
+                    singleproxy["ws-opts"]["path"] >>= path;
+                    break;
+                default:
+                    net = "tcp";
+                    path.clear();
+                    break;
+            }
+            singleproxy["alpn"] >>= alpnList;
 
-                        break;
-                    case "h2"_hash:
-                        singleproxy["h2-opts"]["path"] >>= path;
-                        singleproxy["h2-opts"]["host"][0] >>= host;
-                        edge.clear();
-                        break;
-                    case "xhttp"_hash:
-                        path = singleproxy["xhttp-opts"]["path"].IsDefined()
-                                   ? safe_as<std::string>(singleproxy["xhttp-opts"]["path"])
+            trojanConstruct(node, group, ps, server, port, password, net, host, path, fp, sni, alpnList, true,
+                            udp, tfo, scv, tribool(), underlying_proxy);
+            break;
+        case "snell"_hash:
+            group = SNELL_DEFAULT_GROUP;
+            singleproxy["psk"] >> password;
+            singleproxy["obfs-opts"]["mode"] >>= obfs;
+            singleproxy["obfs-opts"]["host"] >>= host;
+            singleproxy["version"] >>= aid;
+
+            snellConstruct(node, group, ps, server, port, password, obfs, host, to_int(aid, 0), udp, tfo, scv,
+                           underlying_proxy);
+            break;
+        case "wireguard"_hash:
+            group = WG_DEFAULT_GROUP;
+            singleproxy["public-key"] >>= public_key;
+            singleproxy["private-key"] >>= private_key;
+            singleproxy["dns"] >>= dns_server;
+            singleproxy["mtu"] >>= mtu;
+            singleproxy["preshared-key"] >>= password;
+            singleproxy["ip"] >>= ip;
+            singleproxy["ipv6"] >>= ipv6;
+
+            wireguardConstruct(node, group, ps, server, port, ip, ipv6, private_key, public_key, password,
+                               dns_server, mtu, "0", "", "", udp, underlying_proxy);
+            break;
+        case "vless"_hash:
+            group = XRAY_DEFAULT_GROUP;
+            singleproxy["uuid"] >>= id;
+            singleproxy["alterId"] >>= aid;
+            net = singleproxy["network"].IsDefined() ? safe_as<std::string>(singleproxy["network"]) : "tcp";
+            sni = singleproxy["sni"].IsDefined()
+                      ? safe_as<std::string>(singleproxy["sni"])
+                      : safe_as<std::string>(
+                          singleproxy["servername"]);
+            switch (hash_(net)) {
+                case "tcp"_hash:
+                case "http"_hash:
+                    singleproxy["http-opts"]["path"][0] >>= path;
+                    singleproxy["http-opts"]["headers"]["Host"][0] >>= host;
+                    edge.clear();
+                    break;
+                case "ws"_hash:
+                    if (singleproxy["ws-opts"].IsDefined()) {
+                        path = singleproxy["ws-opts"]["path"].IsDefined()
+                                   ? safe_as<std::string>(
+                                       singleproxy["ws-opts"]["path"])
                                    : "/";
-                        singleproxy["xhttp-opts"]["host"] >>= host;
+                        singleproxy["ws-opts"]["headers"]["Host"] >>= host;
                         if (host.empty()) {
-                            singleproxy["xhttp-opts"]["headers"]["Host"] >>= host;
+                            singleproxy["ws-opts"]["headers"]["host"] >>= host;
                         }
-                        singleproxy["xhttp-opts"]["headers"]["Edge"] >>= edge;
-                        if (singleproxy["xhttp-opts"].IsMap()) {
-                            for (const auto &key: xhttp_option_keys) {
-                                if (singleproxy["xhttp-opts"][key].IsScalar()) {
-                                    node.XHTTPOptions[key] = safe_as<std::string>(singleproxy["xhttp-opts"][key]);
-                                }
+                        singleproxy["ws-opts"]["headers"]["Edge"] >>= edge;
+                        if (singleproxy["ws-opts"]["v2ray-http-upgrade"].IsDefined()) {
+                            v2ray_http_upgrade = safe_as<std::string>(singleproxy["ws-opts"]["v2ray-http-upgrade"]);
+                        }
+                    } else {
+                        path = singleproxy["ws-path"].IsDefined()
+                                   ? safe_as<std::string>(singleproxy["ws-path"])
+                                   : "/";
+                        singleproxy["ws-headers"]["Host"] >>= host;
+                        singleproxy["ws-headers"]["Edge"] >>= edge;
+                    }
+
+                    break;
+                case "h2"_hash:
+                    singleproxy["h2-opts"]["path"] >>= path;
+                    singleproxy["h2-opts"]["host"][0] >>= host;
+                    edge.clear();
+                    break;
+                case "xhttp"_hash:
+                    path = singleproxy["xhttp-opts"]["path"].IsDefined()
+                               ? safe_as<std::string>(singleproxy["xhttp-opts"]["path"])
+                               : "/";
+                    singleproxy["xhttp-opts"]["host"] >>= host;
+                    if (host.empty()) {
+                        singleproxy["xhttp-opts"]["headers"]["Host"] >>= host;
+                    }
+                    singleproxy["xhttp-opts"]["headers"]["Edge"] >>= edge;
+                    if (singleproxy["xhttp-opts"].IsMap()) {
+                        for (const auto &key: xhttp_option_keys) {
+                            if (singleproxy["xhttp-opts"][key].IsScalar()) {
+                                node.XHTTPOptions[key] = safe_as<std::string>(singleproxy["xhttp-opts"][key]);
                             }
                         }
-                        break;
-                    case "grpc"_hash:
-                        singleproxy["servername"] >>= host;
-                        singleproxy["grpc-opts"]["grpc-service-name"] >>= path;
-                        edge.clear();
-                        break;
-                    default:
-                        continue;
-                }
+                    }
+                    break;
+                case "grpc"_hash:
+                    singleproxy["servername"] >>= host;
+                    singleproxy["grpc-opts"]["grpc-service-name"] >>= path;
+                    edge.clear();
+                    break;
+                default:
+                    return false;
+            }
 
-                tls = safe_as<std::string>(singleproxy["tls"]) == "true" ? "tls" : "";
-                if (singleproxy["reality-opts"].IsDefined()) {
-                    host = singleproxy["sni"].IsDefined()
-                               ? safe_as<std::string>(singleproxy["sni"])
-                               : safe_as<std::string>(singleproxy["servername"]);
-                    printf("host:%s", host.c_str());
-                    singleproxy["reality-opts"]["public-key"] >>= pbk;
-                    singleproxy["reality-opts"]["short-id"] >>= sid;
-                }
-                singleproxy["flow"] >>= flow;
-                singleproxy["client-fingerprint"] >>= fp;
-                singleproxy["alpn"] >>= alpnList;
-                singleproxy["packet-encoding"] >>= packet_encoding;
-                singleproxy["encryption"] >>= encryption;
-                bool vless_udp;
-                singleproxy["udp"] >> vless_udp;
-                vlessConstruct(node, XRAY_DEFAULT_GROUP, ps, server, port, type, id, aid, net, "auto", flow, mode,
-                               path, host, "", tls, pbk, sid, fp, sni, alpnList, packet_encoding, encryption, udp,
-                               tribool(), tribool(), tribool(), underlying_proxy, v2ray_http_upgrade);
-                break;
-            case "hysteria"_hash:
-                group = HYSTERIA_DEFAULT_GROUP;
-                singleproxy["auth_str"] >> auth;
+            tls = safe_as<std::string>(singleproxy["tls"]) == "true" ? "tls" : "";
+            if (singleproxy["reality-opts"].IsDefined()) {
+                host = singleproxy["sni"].IsDefined()
+                           ? safe_as<std::string>(singleproxy["sni"])
+                           : safe_as<std::string>(singleproxy["servername"]);
+                printf("host:%s", host.c_str());
+                singleproxy["reality-opts"]["public-key"] >>= pbk;
+                singleproxy["reality-opts"]["short-id"] >>= sid;
+            }
+            singleproxy["flow"] >>= flow;
+            singleproxy["client-fingerprint"] >>= fp;
+            singleproxy["alpn"] >>= alpnList;
+            singleproxy["packet-encoding"] >>= packet_encoding;
+            singleproxy["encryption"] >>= encryption;
+            bool vless_udp;
+            singleproxy["udp"] >> vless_udp;
+            vlessConstruct(node, XRAY_DEFAULT_GROUP, ps, server, port, type, id, aid, net, "auto", flow, mode,
+                           path, host, "", tls, pbk, sid, fp, sni, alpnList, packet_encoding, encryption, udp,
+                           tribool(), tribool(), tribool(), underlying_proxy, v2ray_http_upgrade);
+            break;
+        case "hysteria"_hash:
+            group = HYSTERIA_DEFAULT_GROUP;
+            singleproxy["auth_str"] >> auth;
+            if (auth.empty()) {
+                singleproxy["auth-str"] >> auth;
                 if (auth.empty()) {
-                    singleproxy["auth-str"] >> auth;
-                    if (auth.empty()) {
-                        singleproxy["password"] >> auth;
-                    }
+                    singleproxy["password"] >> auth;
                 }
-                singleproxy["up"] >> up;
-                singleproxy["down"] >> down;
-                singleproxy["obfs"] >> obfsParam;
-                singleproxy["protocol"] >> type;
-                singleproxy["sni"] >> host;
-                singleproxy["alpn"][0] >> alpn;
-                singleproxy["alpn"] >> alpnList;
-                singleproxy["protocol"] >> insecure;
-                singleproxy["ports"] >> ports;
-                sni = host;
-                hysteriaConstruct(node, group, ps, server, port, type, auth, "", host, up, down, alpn, obfsParam,
-                                  insecure, ports, sni,
-                                  udp, tfo, scv, tribool(), underlying_proxy);
-                break;
-            case "hysteria2"_hash:
-                group = HYSTERIA2_DEFAULT_GROUP;
-                singleproxy["password"] >>= password;
-                if (password.empty())
-                    singleproxy["auth"] >>= password;
-                if (singleproxy["up"].IsDefined()) {
-                    singleproxy["up"] >>= up;
-                    if (up.empty()) {
-                        try {
-                            up = singleproxy["up"].as<std::string>();
-                        } catch (const YAML::BadConversion& e) {
-                        }
+            }
+            singleproxy["up"] >> up;
+            singleproxy["down"] >> down;
+            singleproxy["obfs"] >> obfsParam;
+            singleproxy["protocol"] >> type;
+            singleproxy["sni"] >> host;
+            singleproxy["alpn"][0] >> alpn;
+            singleproxy["alpn"] >> alpnList;
+            singleproxy["protocol"] >> insecure;
+            singleproxy["ports"] >> ports;
+            sni = host;
+            hysteriaConstruct(node, group, ps, server, port, type, auth, "", host, up, down, alpn, obfsParam,
+                              insecure, ports, sni,
+                              udp, tfo, scv, tribool(), underlying_proxy);
+            break;
+        case "hysteria2"_hash:
+            group = HYSTERIA2_DEFAULT_GROUP;
+            singleproxy["password"] >>= password;
+            if (password.empty())
+                singleproxy["auth"] >>= password;
+            if (singleproxy["up"].IsDefined()) {
+                singleproxy["up"] >>= up;
+                if (up.empty()) {
+                    try {
+                        up = singleproxy["up"].as<std::string>();
+                    } catch (const YAML::BadConversion& e) {
                     }
                 }
-                if (singleproxy["down"].IsDefined()) {
-                    singleproxy["down"] >>= down;
-                    if (down.empty()) {
-                        try {
-                            down = singleproxy["down"].as<std::string>();
-                        } catch (const YAML::BadConversion& e) {
-                        }
+            }
+            if (singleproxy["down"].IsDefined()) {
+                singleproxy["down"] >>= down;
+                if (down.empty()) {
+                    try {
+                        down = singleproxy["down"].as<std::string>();
+                    } catch (const YAML::BadConversion& e) {
                     }
                 }
-                singleproxy["obfs"] >>= obfsParam;
-                singleproxy["obfs-password"] >>= obfsPassword;
-                singleproxy["sni"] >>= host;
+            }
+            singleproxy["obfs"] >>= obfsParam;
+            singleproxy["obfs-password"] >>= obfsPassword;
+            singleproxy["sni"] >>= host;
+            singleproxy["alpn"][0] >>= alpn;
+            singleproxy["ports"] >> ports;
+            sni = host;
+            hysteria2Construct(node, group, ps, server, port, password, host, up, down, alpn, obfsParam,
+                               obfsPassword, sni, public_key, ports, udp, tfo, scv, underlying_proxy);
+            break;
+        case "tuic"_hash:
+            group = TUIC_DEFAULT_GROUP;
+            uint16_t request_timeout;
+            singleproxy["password"] >>= password;
+            singleproxy["uuid"] >>= id;
+            singleproxy["congestion-controller"] >>= congestion_control;
+            singleproxy["udp-relay-mode"] >>= udp_relay_mode;
+            singleproxy["sni"] >>= sni;
+            if (!singleproxy["alpn"].IsNull()) {
                 singleproxy["alpn"][0] >>= alpn;
-                singleproxy["ports"] >> ports;
-                sni = host;
-                hysteria2Construct(node, group, ps, server, port, password, host, up, down, alpn, obfsParam,
-                                   obfsPassword, sni, public_key, ports, udp, tfo, scv, underlying_proxy);
-                break;
-            case "tuic"_hash:
-                group = TUIC_DEFAULT_GROUP;
-                uint16_t request_timeout;
-                singleproxy["password"] >>= password;
-                singleproxy["uuid"] >>= id;
-                singleproxy["congestion-controller"] >>= congestion_control;
-                singleproxy["udp-relay-mode"] >>= udp_relay_mode;
-                singleproxy["sni"] >>= sni;
-                if (!singleproxy["alpn"].IsNull()) {
-                    singleproxy["alpn"][0] >>= alpn;
-                }
-                singleproxy["disable-sni"] >>= disableSni;
-                singleproxy["reduce-rtt"] >>= reduceRtt;
-                singleproxy["token"] >>= token;
-                singleproxy["request-timeout"] >>= request_timeout;
-                tuicConstruct(node, TUIC_DEFAULT_GROUP, ps, server, port, password, congestion_control, alpn, sni, id,
-                              udp_relay_mode, token,
-                              tribool(),
-                              tribool(), scv, reduceRtt, disableSni, request_timeout, underlying_proxy);
+            }
+            singleproxy["disable-sni"] >>= disableSni;
+            singleproxy["reduce-rtt"] >>= reduceRtt;
+            singleproxy["token"] >>= token;
+            singleproxy["request-timeout"] >>= request_timeout;
+            tuicConstruct(node, TUIC_DEFAULT_GROUP, ps, server, port, password, congestion_control, alpn, sni, id,
+                          udp_relay_mode, token,
+                          tribool(),
+                          tribool(), scv, reduceRtt, disableSni, request_timeout, underlying_proxy);
 
-                break;
-            case "anytls"_hash:
-                group = ANYTLS_DEFAULT_GROUP;
-                singleproxy["password"] >>= password;
-                singleproxy["sni"] >>= sni;
-
-                if (!singleproxy["alpn"].IsNull() && singleproxy["alpn"].size() >= 1) {
-                    singleproxy["alpn"][0] >>= alpn;
-                    alpns.push_back(alpn);
-                    if (singleproxy["alpn"].size() >= 2 && !singleproxy["alpn"][1].IsNull()) {
-                        singleproxy["alpn"][1] >>= alpn2;
-                        alpns.push_back(alpn2);
-                    }
-                }
-                singleproxy["fingerprint"] >>= fingerprint;
-                anyTlSConstruct(node, ANYTLS_DEFAULT_GROUP, ps, port, password, server, alpns, fingerprint, sni,
-                                udp,
-                                tribool(), scv, tribool(), underlying_proxy, 30, 30, 0);
-                break;
-            case "mieru"_hash:
-                group = MIERU_DEFAULT_GROUP;
-                singleproxy["password"] >>= password;
-                singleproxy["username"] >>= user;
-                singleproxy["port-range"] >>= ports;
-                if (!singleproxy["multiplexing"].IsNull()) {
-                    singleproxy["multiplexing"] >>= multiplexing;
-                }
-                transfer_protocol = "TCP";
-                if (!singleproxy["transport"].IsNull()) {
-                    singleproxy["transport"] >>= transfer_protocol;
+            break;
+        case "anytls"_hash:
+            group = ANYTLS_DEFAULT_GROUP;
+            singleproxy["password"] >>= password;
+            singleproxy["sni"] >>= sni;
+
+            if (!singleproxy["alpn"].IsNull() && singleproxy["alpn"].size() >= 1) {
+                singleproxy["alpn"][0] >>= alpn;
+                alpns.push_back(alpn);
+                if (singleproxy["alpn"].size() >= 2 && !singleproxy["alpn"][1].IsNull()) {
+                    singleproxy["alpn"][1] >>= alpn2;
+                    alpns.push_back(alpn2);
                 }
-                mieruConstruct(node, MIERU_DEFAULT_GROUP, ps, port, password, server, ports, user, multiplexing,
-                               transfer_protocol,
-                               udp,
-                               tribool(), scv, tribool(), underlying_proxy);
-                break;
-            default:
-                continue;
-        }
+            }
+            singleproxy["fingerprint"] >>= fingerprint;
+            anyTlSConstruct(node, ANYTLS_DEFAULT_GROUP, ps, port, password, server, alpns, fingerprint, sni,
+                            udp,
+                            tribool(), scv, tribool(), underlying_proxy, 30, 30, 0);
+            break;
+        case "mieru"_hash:
+            group = MIERU_DEFAULT_GROUP;
+            singleproxy["password"] >>= password;
+            singleproxy["username"] >>= user;
+            singleproxy["port-range"] >>= ports;
+            if (!singleproxy["multiplexing"].IsNull()) {
+                singleproxy["multiplexing"] >>= multiplexing;
+            }
+            transfer_protocol = "TCP";
+            if (!singleproxy["transport"].IsNull()) {
+                singleproxy["transport"] >>= transfer_protocol;
+            }
+            mieruConstruct(node, MIERU_DEFAULT_GROUP, ps, port, password, server, ports, user, multiplexing,
+                           transfer_protocol,
+                           udp,
+                           tribool(), scv, tribool(), underlying_proxy);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
 
+void explodeClash(Node yamlnode, std::vector<Proxy> &nodes) {
+    uint32_t index = nodes.size();
+    const std::string section = yamlnode["proxies"].IsDefined() ? "proxies" : "Proxy";
+    for (uint32_t i = 0; i < yamlnode[section].size(); i++) {
+        Proxy node;
+        if (!explodeClashProxy(yamlnode[section][i], node))
+            continue;
         node.Id = index;
         nodes.emplace_back(std::move(node));
         index++;
@@ -1752,20 +1788,21 @@ void explodeStdVMess(std::string vmess, Proxy &node) {
     if (regGetMatch(vmess, stdvmess_matcher, 8, 0, &net, &tls, &id, &aid, &add, &port, &addition))
         return;
 
+    UrlArgs args(addition);
     switch (hash_(net)) {
         case "tcp"_hash:
         case "kcp"_hash:
-            type = getUrlArg(addition, "type");
+            type = args.get("type");
             break;
         case "http"_hash:
         case "ws"_hash:
-            host = getUrlArg(addition, "host");
-            path = getUrlArg(addition, "path");
+            host = args.get("host");
+            path = args.get("path");
             break;
         case "quic"_hash:
-            type = getUrlArg(addition, "security");
-            host = getUrlArg(addition, "type");
-            path = getUrlArg(addition, "key");
+            type = args.get("security");
+            host = args.get("type");
+            path = args.get("key");
             break;
         default:
             return;
@@ -1773,7 +1810,7 @@ void explodeStdVMess(std::string vmess, Proxy &node) {
 
     if (remarks.empty())
         remarks = add + ":" + port;
-    std::vector<std::string> alpnList = getUrlAlpnList(addition);
+    std::vector<std::string> alpnList = getUrlAlpnList(args);
     vmessConstruct(node, V2RAY_DEFAULT_GROUP, remarks, add, port, type, id, aid, net, "auto", path, host, "", tls, "",
                    alpnList);
 }
@@ -1789,16 +1826,17 @@ void explodeStdHysteria(std::string hysteria, Proxy &node) {
     const std::string stdhysteria_matcher = R"(^(.*)[:](\d+)[?](.*)$)";
     if (regGetMatch(hysteria, stdhysteria_matcher, 4, 0, &add, &port, &addition))
         return;
-    type = getUrlArg(addition, "protocol");
-    auth = getUrlArg(addition, "auth");
-    auth_str = getUrlArg(addition, "auth_str");
-    host = getUrlArg(addition, "peer");
-    insecure = getUrlArg(addition, "insecure");
-    up = getUrlArg(addition, "upmbps");
-    down = getUrlArg(addition, "downmbps");
-    alpn = getUrlAlpn(addition);
-    obfsParam = getUrlArg(addition, "obfsParam");
-    sni = getUrlArg(addition, "peer");
+    UrlArgs args(addition);
+    type = args.get("protocol");
+    auth = args.get("auth");
+    auth_str = args.get("auth_str");
+    host = args.get("peer");
+    insecure = args.get("insecure");
+    up = args.get("upmbps");
+    down = args.get("downmbps");
+    alpn = getUrlAlpn(args);
+    obfsParam = args.get("obfsParam");
+    sni = args.get("peer");
 
     if (remarks.empty())
         remarks = add + ":" + port;
@@ -1830,16 +1868,17 @@ void explodeStdMieru(std::string mieru, Proxy &node) {
     if (regGetMatch(mieru, R"(^(.*?):(.*?)@(.*)$)", 4, 0, &username, &password, &host))
         return;
 
+    UrlArgs args(addition);
     // 提取端口（port=多个情况）
-    port = getUrlArg(addition, "port");
+    port = args.get("port");
     if (port.find('-') != std::string::npos) {
         ports = port;
     }
     // 提取协议（多个 protocol）
-    protocol = getUrlArg(addition, "protocol");
+    protocol = args.get("protocol");
 
-    multiplexing = getUrlArg(addition, "multiplexing");
-    mtu = getUrlArg(addition, "mtu");
+    multiplexing = args.get("multiplexing");
+    mtu = args.get("mtu");
 
     if (remarks.empty())
         remarks = host;
@@ -1864,11 +1903,12 @@ void explodeStdHysteria2(std::string hysteria2, Proxy &node) {
         hysteria2.erase(pos);
     }
 
+    UrlArgs args(addition);
     if (strFind(hysteria2, "@")) {
         if (regGetMatch(hysteria2, R"(^(.*?)@(.*)[:](\d+)$)", 4, 0, &password, &add, &port))
             return;
     } else {
-        password = getUrlArg(addition, "password");
+        password = args.get("password");
         if (password.empty())
             return;
 
@@ -1879,15 +1919,15 @@ void explodeStdHysteria2(std::string hysteria2, Proxy &node) {
             return;
     }
 
-    scv = getUrlArg(addition, "insecure");
-    up = getUrlArg(addition, "up");
-    down = getUrlArg(addition, "down");
-    alpn = getUrlAlpn(addition);
-    obfsParam = getUrlArg(addition, "obfs");
-    obfsPassword = getUrlArg(addition, "obfs-password");
-    host = getUrlArg(addition, "sni");
-    sni = getUrlArg(addition, "sni");
-    ports = getUrlArg(addition, "ports");
+    scv = args.get("insecure");
+    up = args.get("up");
+    down = args.get("down");
+    alpn = getUrlAlpn(args);
+    obfsParam = args.get("obfs");
+    obfsPassword = args.get("obfs-password");
+    host = args.get("sni");
+    sni = args.get("sni");
+    ports = args.get("ports");
     if (remarks.empty())
         remarks = add + ":" + port;
 
@@ -1909,42 +1949,43 @@ void explodeStdVless(std::string vless, Proxy &node) {
     if (regGetMatch(vless, stdvless_matcher, 5, 0, &id, &add, &port, &addition))
         return;
 
-    tls = getUrlArg(addition, "security");
-    net = getUrlArg(addition, "type");
-    flow = getUrlArg(addition, "flow");
-    pbk = getUrlArg(addition, "pbk");
-    sid = getUrlArg(addition, "sid");
-    encryption = getUrlArg(addition, "encryption");
-    fp = getUrlArg(addition, "fp");
-    std::string packet_encoding = getUrlArg(addition, "packet-encoding");
-    std::vector<std::string> alpnList = getUrlAlpnList(addition);
+    UrlArgs args(addition);
+    tls = args.get("security");
+    net = args.get("type");
+    flow = args.get("flow");
+    pbk = args.get("pbk");
+    sid = args.get("sid");
+    encryption = args.get("encryption");
+    fp = args.get("fp");
+    std::string packet_encoding = args.get("packet-encoding");
+    std::vector<std::string> alpnList = getUrlAlpnList(args);
     switch (hash_(net)) {
         case "tcp"_hash:
         case "ws"_hash:
         case "h2"_hash:
-            type = getUrlArg(addition, "headerType");
-            host = getUrlArg(addition, strFind(addition, "sni") ? "sni" : "host");
-            path = getUrlArg(addition, "path");
+            type = args.get("headerType");
+            host = args.get(strFind(addition, "sni") ? "sni" : "host");
+            path = args.get("path");
             break;
         case "grpc"_hash:
-            host = getUrlArg(addition, "sni");
-            path = getUrlArg(addition, "serviceName");
-            mode = getUrlArg(addition, "mode");
+            host = args.get("sni");
+            path = args.get("serviceName");
+            mode = args.get("mode");
             break;
         case "quic"_hash:
-            type = getUrlArg(addition, "headerType");
-            host = getUrlArg(addition, strFind(addition, "sni") ? "sni" : "quicSecurity");
-            path = getUrlArg(addition, "key");
+            type = args.get("headerType");
+            host = args.get(strFind(addition, "sni") ? "sni" : "quicSecurity");
+            path = args.get("key");
             break;
         case "xhttp"_hash:
-            type = getUrlArg(addition, "headerType");
-            host = getUrlArg(addition, strFind(addition, "sni") ? "sni" : "host");
-            path = getUrlArg(addition, "path");
-            readXHTTPExtraOptions(addition, node);
+            type = args.get("headerType");
+            host = args.get(strFind(addition, "sni") ? "sni" : "host");
+            path = args.get("path");
+            readXHTTPExtraOptions(args, node);
             for (const auto &key: xhttp_option_keys) {
-                std::string value = getUrlArg(addition, key);
+                std::string value = args.get(key);
                 if (value.empty()) {
-                    value = getUrlArg(addition, replaceAllDistinct(key, "-", "_"));
+                    value = args.get(replaceAllDistinct(key, "-", "_"));
                 }
                 if (!value.empty()) {
                     node.XHTTPOptions[key] = value;
@@ -1956,7 +1997,7 @@ void explodeStdVless(std::string vless, Proxy &node) {
     }
     if (remarks.empty())
         remarks = add + ":" + port;
-    sni = getUrlArg(addition, "sni");
+    sni = args.get("sni");
     vlessConstruct(node, XRAY_DEFAULT_GROUP, remarks, add, port, type, id, aid, net, "auto", flow, mode, path, host, "",
                    tls, pbk, sid, fp, sni, alpnList, packet_encoding, encryption);
     return;
@@ -1976,28 +2017,29 @@ void explodeShadowrocket(std::string rocket, Proxy &node) {
         return;
     if (port == "0")
         return;
-    remarks = urlDecode(getUrlArg(addition, "remarks"));
-    obfs = getUrlArg(addition, "obfs");
+    UrlArgs args(addition);
+    remarks = urlDecode(args.get("remarks"));
+    obfs = args.get("obfs");
     if (!obfs.empty()) {
         if (obfs == "websocket") {
             net = "ws";
-            host = getUrlArg(addition, "obfsParam");
-            path = getUrlArg(addition, "path");
+            host = args.get("obfsParam");
+            path = args.get("path");
         }
     } else {
-        net = getUrlArg(addition, "network");
-        host = getUrlArg(addition, "wsHost");
-        path = getUrlArg(addition, "wspath");
+        net = args.get("network");
+        host = args.get("wsHost");
+        path = args.get("wspath");
     }
-    tls = getUrlArg(addition, "tls") == "1" ? "tls" : "";
-    aid = getUrlArg(addition, "aid");
+    tls = args.get("tls") == "1" ? "tls" : "";
+    aid = args.get("aid");
 
     if (aid.empty())
         aid = "0";
 
     if (remarks.empty())
         remarks = add + ":" + port;
-    std::vector<std::string> alpnList = getUrlAlpnList(addition);
+    std::vector<std::string> alpnList = getUrlAlpnList(args);
     vmessConstruct(node, V2RAY_DEFAULT_GROUP, remarks, add, port, type, id, aid, net, cipher, path, host, "", tls, "",
                    alpnList);
 }
@@ -2027,13 +2069,14 @@ void explodeKitsunebi(std::string kit, Proxy &node) {
     }
     if (port == "0")
         return;
-    net = getUrlArg(addition, "network");
-    tls = getUrlArg(addition, "tls") == "true" ? "tls" : "";
-    host = getUrlArg(addition, "ws.host");
+    UrlArgs args(addition);
+    net = args.get("network");
+    tls = args.get("tls") == "true" ? "tls" : "";
+    host = args.get("ws.host");
 
     if (remarks.empty())
         remarks = add + ":" + port;
-    std::vector<std::string> alpnList = getUrlAlpnList(addition);
+    std::vector<std::string> alpnList = getUrlAlpnList(args);
     vmessConstruct(node, V2RAY_DEFAULT_GROUP, remarks, add, port, type, id, aid, net, cipher, path, host, "", tls, "",
                    alpnList);
 }
@@ -2963,23 +3006,178 @@ void explodeNetchConf(std::string netch, std::vector<Proxy> &nodes) {
     }
 }
 
-int explodeConfContent(const std::string &content, std::vector<Proxy> &nodes) {
-    ConfType filetype = ConfType::Unknow;
-
-    if (strFind(content, "\"version\""))
-        filetype = ConfType::SS;
-    else if (strFind(content, "\"serverSubscribes\""))
-        filetype = ConfType::SSR;
-    else if (strFind(content, "\"uiItem\"") || strFind(content, "vnext"))
-        filetype = ConfType::V2Ray;
-    else if (strFind(content, "\"proxy_apps\""))
-        filetype = ConfType::SSConf;
-    else if (strFind(content, "\"idInUse\""))
-        filetype = ConfType::SSTap;
-    else if (strFind(content, "\"local_address\"") && strFind(content, "\"local_port\""))
-        filetype = ConfType::SSR; //use ssr config parser
-    else if (strFind(content, "\"ModeFileNameType\""))
-        filetype = ConfType::Netch;
+static bool isSniffWordChar(char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static bool looksLikeLinkList(std::string_view body) {
+    /// link lists are a single base64 blob or one scheme://... per line, the first line is enough to tell
+    std::string_view line = body.substr(0, std::min(body.find_first_of("\r\n"), std::string_view::size_type(4096)));
+    auto scheme_end = line.find("://");
+    if (scheme_end != std::string_view::npos && scheme_end > 0 &&
+        std::all_of(line.begin(), line.begin() + scheme_end, [](char c) {
+            return isSniffWordChar(c) || c == '+' || c == '-' || c == '.';
+        }))
+        return true;
+    /// otherwise it has to be shaped like base64: long enough, padding only at the end,
+    /// so that YAML document markers and similar lines are left to the other parsers
+    auto data_end = line.find_last_not_of('=');
+    if (line.size() < 8 || data_end == std::string_view::npos || line.size() - data_end - 1 > 2)
+        return false;
+    if (data_end + 1 != line.size() && line.size() % 4 != 0)
+        return false;
+    std::string_view data = line.substr(0, data_end + 1);
+    return std::all_of(data.begin(), data.end(), [](char c) {
+        return isSniffWordChar(c) || c == '+' || c == '/' || c == '-';
+    }) && std::any_of(data.begin(), data.end(), [](char c) {
+        return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+    });
+}
+
+ConfType sniffConfType(const std::string &content) {
+    if (startsWith(content, "ssd://"))
+        return ConfType::SSD;
+
+    std::string_view body = content;
+    if (body.starts_with("\xEF\xBB\xBF"))
+        body.remove_prefix(3);
+    auto first = body.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos)
+        return ConfType::Unknow;
+    body.remove_prefix(first);
+
+    /// client configurations are JSON objects, never look for their keys anywhere else
+    bool is_json = body.front() == '{';
+    if (!is_json && looksLikeLinkList(body))
+        return ConfType::SUB;
+
+    ConfType json_type = ConfType::Unknow;
+    bool local_address = false, local_port = false, v2ray = false, ssconf = false, sstap = false, netch = false;
+    bool clash = false, inbounds = false, outbounds = false, route = false;
+    string_size size = body.size(), pos = 0;
+    while (pos < size) {
+        if (!isSniffWordChar(body[pos])) {
+            pos++;
+            continue;
+        }
+        string_size begin = pos;
+        while (pos < size && isSniffWordChar(body[pos]))
+            pos++;
+        std::string_view word = body.substr(begin, pos - begin);
+        bool quoted = begin > 0 && body[begin - 1] == '"' && pos < size && body[pos] == '"';
+        string_size after = quoted ? pos + 1 : pos;
+        bool is_key = after < size && body[after] == ':';
+
+        switch (hash_(word)) {
+            case "version"_hash:
+                if (is_json && quoted)
+                    json_type = ConfType::SS;
+                break;
+            case "serverSubscribes"_hash:
+                if (is_json && quoted && json_type != ConfType::SS)
+                    json_type = ConfType::SSR;
+                break;
+            case "uiItem"_hash:
+                v2ray = v2ray || quoted;
+                break;
+            case "vnext"_hash:
+                v2ray = true;
+                break;
+            case "proxy_apps"_hash:
+                ssconf = ssconf || quoted;
+                break;
+            case "idInUse"_hash:
+                sstap = sstap || quoted;
+                break;
+            case "local_address"_hash:
+                local_address = local_address || quoted;
+                break;
+            case "local_port"_hash:
+                local_port = local_port || quoted;
+                break;
+            case "ModeFileNameType"_hash:
+                netch = netch || quoted;
+                break;
+            case "Proxy"_hash:
+            case "proxies"_hash:
+                clash = clash || is_key;
+                break;
+            case "inbounds"_hash:
+                inbounds = inbounds || is_key;
+                break;
+            case "outbounds"_hash:
+                outbounds = outbounds || is_key;
+                break;
+            case "route"_hash:
+                route = route || is_key;
+                break;
+            default:
+                break;
+        }
+        /// nothing outranks these, stop scanning
+        if (json_type == ConfType::SS || (!is_json && clash))
+            break;
+    }
+
+    if (is_json) {
+        if (json_type != ConfType::Unknow)
+            return json_type;
+        if (v2ray)
+            return ConfType::V2Ray;
+        if (ssconf)
+            return ConfType::SSConf;
+        if (sstap)
+            return ConfType::SSTap;
+        if (local_address && local_port)
+            return ConfType::SSR; //use ssr config parser
+        if (netch)
+            return ConfType::Netch;
+    }
+    if (clash)
+        return ConfType::Clash;
+    if (inbounds && outbounds && route)
+        return ConfType::SingBox;
+    return ConfType::Unknow;
+}
+
+/// reuse state of one explodeConfContent() call, entries are recorded relative to base
+struct SubParseReuse {
+    const SubParseMemo *previous = nullptr;
+    SubParseMemo *current = nullptr;
+    size_t base = 0;
+
+    const Proxy *find(std::string_view source) const {
+        if (!previous)
+            return nullptr;
+        auto iter = previous->entries.find(source);
+        return iter == previous->entries.end() ? nullptr : &previous->nodes[iter->second];
+    }
+
+    void record(std::string_view source, size_t position) {
+        current->entries.emplace(source, position - base);
+    }
+
+    /// move a text derived from the body into the memo, so entries may point into it
+    const std::string &keep(std::string text) {
+        return current->texts.emplace_back(std::move(text));
+    }
+};
+
+size_t SubParseMemo::bytes() const {
+    size_t total = 0;
+    for (const std::string &x: texts)
+        total += x.size();
+    /// the string fields of a node take about as much as the text it was parsed from
+    total *= 2;
+    total += nodes.size() * sizeof(Proxy);
+    total += entries.size() * (sizeof(std::string_view) + sizeof(size_t) + 2 * sizeof(void *));
+    return total;
+}
+
+static void explodeSub(const std::string &sub, std::vector<Proxy> &nodes, ConfType type, SubParseReuse *reuse);
+
+static int explodeConfContent(const std::string &content, std::vector<Proxy> &nodes, SubParseReuse *reuse) {
+    ConfType filetype = sniffConfType(content);
 
     switch (filetype) {
         case ConfType::SS:
@@ -3002,12 +3200,26 @@ int explodeConfContent(const std::string &content, std::vector<Proxy> &nodes) {
             break;
         default:
             //try to parse as a local subscription
-            explodeSub(content, nodes);
+            explodeSub(content, nodes, filetype, reuse);
     }
 
     return !nodes.empty();
 }
 
+int explodeConfContent(const std::string &content, std::vector<Proxy> &nodes) {
+    return explodeConfContent(content, nodes, nullptr);
+}
+
+int explodeConfContent(const std::string &content, std::vector<Proxy> &nodes, const SubParseMemo *previous, SubParseMemo &current) {
+    SubParseReuse reuse{previous, &current, nodes.size()};
+    current.entries.clear();
+    current.texts.clear();
+    /// parse the memo's own copy, so the recorded entries stay valid as long as the memo
+    int result = explodeConfContent(reuse.keep(content), nodes, &reuse);
+    current.nodes.assign(nodes.begin() + reuse.base, nodes.end());
+    return result;
+}
+
 void explodeSingboxTransport(rapidjson::Value &singboxNode, std::string &net, std::string &host, std::string &path,
                              std::string edge) {
     if (singboxNode.HasMember("transport") && singboxNode["transport"].IsObject()) {
@@ -3333,10 +3545,11 @@ void explodeTuic(const std::string &tuic, Proxy &node) {
     if (add.length() > 2 && add.front() == '[' && add.back() == ']')
         add = add.substr(1, add.length() - 2);
 
-    scv = getUrlArg(addition, "insecure");
-    alpn = getUrlAlpn(addition);
-    sni = getUrlArg(addition, "sni");
-    congestion_control = getUrlArg(addition, "congestion_control");
+    UrlArgs args(addition);
+    scv = args.get("insecure");
+    alpn = getUrlAlpn(args);
+    sni = args.get("sni");
+    congestion_control = args.get("congestion_control");
     if (remarks.empty())
         remarks = add + ":" + port;
     tuicConstruct(node, TUIC_DEFAULT_GROUP, remarks, add, port, password, congestion_control, alpn, sni, uuid, "native",
@@ -3380,131 +3593,468 @@ void explodeAnyTLS(std::string anytls, Proxy &node) {
     if (remarks.empty())
         remarks = add + ":" + port;
 
-    alpnList = getUrlAlpnList(addition);
+    UrlArgs args(addition);
+    alpnList = getUrlAlpnList(args);
 
-    fp = getUrlArg(addition, "fp");
+    fp = args.get("fp");
     if (fp.empty())
-        fp = getUrlArg(addition, "fingerprint");
+        fp = args.get("fingerprint");
     if (fp.empty())
-        fp = urlDecode(getUrlArg(addition, "hpkp"));
-    sni = getUrlArg(addition, "sni");
+        fp = urlDecode(args.get("hpkp"));
+    sni = args.get("sni");
     if (sni.empty())
-        sni = getUrlArg(addition, "peer");
-    udp = getUrlArg(addition, "udp");
-    tfo = getUrlArg(addition, "tfo");
-    scv = getUrlArg(addition, "insecure");
+        sni = args.get("peer");
+    udp = args.get("udp");
+    tfo = args.get("tfo");
+    scv = args.get("insecure");
 
     anyTlSConstruct(node, ANYTLS_DEFAULT_GROUP, remarks, port, password, add, alpnList, fp, sni, udp, tfo, scv,
                     tribool(), "", 30, 30, 0);
 }
 
-void explode(const std::string &link, Proxy &node) {
-    if (startsWith(link, "ssr://"))
-        explodeSSR(link, node);
-    else if (startsWith(link, "vmess://") || startsWith(link, "vmess1://"))
-        explodeVmess(link, node);
-    else if (startsWith(link, "ss://"))
-        explodeSS(link, node);
-    else if (startsWith(link, "socks://") || startsWith(link, "https://t.me/socks") || startsWith(link, "tg://socks"))
-        explodeSocks(link, node);
-    else if (startsWith(link, "https://t.me/http") || startsWith(link, "tg://http")) //telegram style http link
-        explodeHTTP(link, node);
-    else if (startsWith(link, "Netch://"))
-        explodeNetch(link, node);
-    else if (startsWith(link, "trojan://") || startsWith(link, "trojan-go://"))
-        explodeTrojan(link, node);
-    else if (strFind(link, "vless://") || strFind(link, "vless1://"))
-        explodeVless(link, node);
-    else if (strFind(link, "hysteria://") || strFind(link, "hy://"))
-        explodeHysteria(link, node);
-    else if (strFind(link, "tuic://"))
-        explodeTuic(link, node);
-    else if (strFind(link, "anytls://"))
-        explodeAnyTLS(link, node);
-    else if (strFind(link, "hysteria2://") || strFind(link, "hy2://"))
-        explodeHysteria2(link, node);
-    else if (strFind(link, "mierus://") || strFind(link, "mieru://"))
-        explodeMierus(link, node);
-    else if (isLink(link))
-        explodeHTTPSub(link, node);
-}
-
-void explodeSub(std::string sub, std::vector<Proxy> &nodes) {
-    std::stringstream strstream;
-    std::string strLink;
-    bool processed = false;
+void explode(std::string_view link, Proxy &node) {
+    /// dispatch on the scheme in front of "://", each parser receives its own mutable copy of the link
+    string_size scheme_end = link.find("://");
+    std::string_view scheme = scheme_end != std::string_view::npos ? link.substr(0, scheme_end) : std::string_view();
+    switch (hash_(scheme)) {
+        case "ssr"_hash:
+            explodeSSR(std::string(link), node);
+            return;
+        case "vmess"_hash:
+        case "vmess1"_hash:
+            explodeVmess(std::string(link), node);
+            return;
+        case "ss"_hash:
+            explodeSS(std::string(link), node);
+            return;
+        case "socks"_hash:
+            explodeSocks(std::string(link), node);
+            return;
+        case "Netch"_hash:
+            explodeNetch(std::string(link), node);
+            return;
+        case "trojan"_hash:
+        case "trojan-go"_hash:
+            explodeTrojan(std::string(link), node);
+            return;
+        case "vless"_hash:
+        case "vless1"_hash:
+            explodeVless(std::string(link), node);
+            return;
+        case "hysteria"_hash:
+        case "hy"_hash:
+            explodeHysteria(std::string(link), node);
+            return;
+        case "tuic"_hash:
+            explodeTuic(std::string(link), node);
+            return;
+        case "anytls"_hash:
+            explodeAnyTLS(std::string(link), node);
+            return;
+        case "hysteria2"_hash:
+        case "hy2"_hash:
+            explodeHysteria2(std::string(link), node);
+            return;
+        case "mierus"_hash:
+        case "mieru"_hash:
+            explodeMierus(std::string(link), node);
+            return;
+        case "tg"_hash:
+        case "https"_hash:
+            //telegram style links
+            if (link.starts_with("tg://socks") || link.starts_with("https://t.me/socks")) {
+                explodeSocks(std::string(link), node);
+                return;
+            }
+            if (link.starts_with("tg://http") || link.starts_with("https://t.me/http")) {
+                explodeHTTP(std::string(link), node);
+                return;
+            }
+            break;
+        default:
+            break;
+    }
 
-    //try to parse as SSD configuration
-    if (startsWith(sub, "ssd://")) {
-        explodeSSD(sub, nodes);
-        processed = true;
+    /// links not starting with a known scheme may still carry one further in
+    if (link.find("vless://") != link.npos || link.find("vless1://") != link.npos)
+        explodeVless(std::string(link), node);
+    else if (link.find("hysteria://") != link.npos || link.find("hy://") != link.npos)
+        explodeHysteria(std::string(link), node);
+    else if (link.find("tuic://") != link.npos)
+        explodeTuic(std::string(link), node);
+    else if (link.find("anytls://") != link.npos)
+        explodeAnyTLS(std::string(link), node);
+    else if (link.find("hysteria2://") != link.npos || link.find("hy2://") != link.npos)
+        explodeHysteria2(std::string(link), node);
+    else if (link.find("mierus://") != link.npos || link.find("mieru://") != link.npos)
+        explodeMierus(std::string(link), node);
+    else if (link.starts_with("https://") || link.starts_with("http://") || link.starts_with("data:"))
+        explodeHTTPSub(std::string(link), node);
+}
+
+/// read-only streambuf over an existing buffer, so the YAML parser can consume it without a copy
+struct ViewStreamBuf : std::streambuf {
+    ViewStreamBuf(const char *data, size_t size) {
+        char *begin = const_cast<char *>(data);
+        setg(begin, begin, begin + size);
     }
+};
 
-    //try to parse as clash configuration
-    try {
-        if (!processed && regFind(sub, "\"?(Proxy|proxies)\"?:")) {
-            regGetMatch(sub, R"(^(?:Proxy|proxies):$\s(?:(?:^ +?.*$| *?-.*$|)\s?)+)", 1, &sub);
-            Node yamlnode = Load(sub);
-            if (yamlnode.size() && (yamlnode["Proxy"].IsDefined() || yamlnode["proxies"].IsDefined())) {
-                explodeClash(yamlnode, nodes);
-                processed = true;
-            }
+/// YAML event handler that only builds nodes for the items of the top-level `proxies` (or `Proxy`) sequence,
+/// handing each item over as soon as it is complete; every other top-level value is skipped without building a tree.
+/// Like explodeClash(), `proxies` wins over `Proxy`, so items of a `Proxy` section are held back until the document
+/// ended without a `proxies` one
+class ClashProxyStream : public EventHandler {
+public:
+    /// thrown once the proxy sequence has ended, so the rest of the document is never scanned
+    struct SectionEnd {};
+
+    /// on_proxy also receives the stream position where the item starts
+    explicit ClashProxyStream(std::function<void(const Node &, size_t)> on_proxy) : on_proxy_(std::move(on_proxy)) {}
+
+    bool found() const { return found_; }
+    /// an alias inside the proxies referred to an anchor defined elsewhere in the document
+    bool unresolved() const { return unresolved_; }
+
+    void OnDocumentStart(const Mark &) override {}
+
+    void OnDocumentEnd() override {
+        for (auto &[item, start] : legacy_items_)
+            on_proxy_(item, start);
+        legacy_items_.clear();
+    }
+
+    void OnNull(const Mark &, anchor_t anchor) override {
+        if (in_section_)
+            return addNode(Node(NodeType::Null), anchor);
+        if (depth_ == 1 && !expect_key_ && want_section_) {
+            found_ = true;
+            if (!want_legacy_)
+                legacy_items_.clear();
         }
-    } catch (std::exception &e) {
-        //writeLog(0, e.what(), LOG_LEVEL_DEBUG);
-        //ignore
-        throw;
+        topValueDone();
+    }
+
+    void OnAlias(const Mark &, anchor_t anchor) override {
+        if (!in_section_)
+            return topValueDone();
+        auto iter = anchors_.find(anchor);
+        if (iter == anchors_.end()) {
+            unresolved_ = true;
+            return addNode(Node(NodeType::Null), NullAnchor);
+        }
+        addNode(iter->second, NullAnchor);
+    }
+
+    void OnScalar(const Mark &, const std::string &tag, anchor_t anchor, const std::string &value) override {
+        if (in_section_) {
+            Node node(value);
+            node.SetTag(tag);
+            return addNode(node, anchor);
+        }
+        if (depth_ == 1 && expect_key_) {
+            want_legacy_ = value == "Proxy";
+            want_section_ = value == "proxies" || (want_legacy_ && !found_);
+        }
+        topValueDone();
     }
+
+    void OnSequenceStart(const Mark &mark, const std::string &tag, anchor_t anchor, EmitterStyle::value style) override {
+        if (in_section_)
+            return beginNode(mark, NodeType::Sequence, tag, anchor, style);
+        if (depth_ == 1 && !expect_key_ && want_section_) {
+            in_section_ = found_ = true;
+            in_legacy_ = want_legacy_;
+            if (!in_legacy_)
+                legacy_items_.clear();
+            return;
+        }
+        depth_++;
+    }
+
+    void OnSequenceEnd() override {
+        if (in_section_ && !stack_.empty())
+            return endNode();
+        if (in_section_ && !in_legacy_)
+            throw SectionEnd();
+        if (in_section_)
+            in_section_ = in_legacy_ = false; //keep looking for a `proxies` section
+        else
+            depth_--;
+        topValueDone();
+    }
+
+    void OnMapStart(const Mark &mark, const std::string &tag, anchor_t anchor, EmitterStyle::value style) override {
+        if (in_section_)
+            return beginNode(mark, NodeType::Map, tag, anchor, style);
+        depth_++;
+    }
+
+    void OnMapEnd() override {
+        if (in_section_)
+            return endNode();
+        depth_--;
+        topValueDone();
+    }
+
+private:
+    struct Frame {
+        Node node;
+        Node key;
+        bool has_key = false;
+    };
+
+    std::function<void(const Node &, size_t)> on_proxy_;
+    std::vector<Frame> stack_;
+    size_t item_start_ = 0;
+    std::map<anchor_t, Node> anchors_;
+    std::vector<std::pair<Node, size_t>> legacy_items_;
+    int depth_ = 0;
+    bool expect_key_ = true, want_section_ = false, in_section_ = false;
+    bool want_legacy_ = false, in_legacy_ = false;
+    bool found_ = false, unresolved_ = false;
+
+    /// a complete key or value at the top-level mapping flips between the two
+    void topValueDone() {
+        if (depth_ != 1)
+            return;
+        if (!expect_key_)
+            want_section_ = false;
+        expect_key_ = !expect_key_;
+    }
+
+    void beginNode(const Mark &mark, NodeType::value type, const std::string &tag, anchor_t anchor, EmitterStyle::value style) {
+        if (stack_.empty())
+            item_start_ = mark.pos;
+        Node node(type);
+        node.SetTag(tag);
+        node.SetStyle(style);
+        if (anchor != NullAnchor)
+            anchors_.emplace(anchor, node);
+        stack_.push_back(Frame{node, Node(), false});
+    }
+
+    void endNode() {
+        Node node = stack_.back().node;
+        stack_.pop_back();
+        addNode(node, NullAnchor);
+    }
+
+    void addNode(const Node &node, anchor_t anchor) {
+        if (anchor != NullAnchor)
+            anchors_.emplace(anchor, node);
+        if (stack_.empty()) {
+            if (node.IsMap() && in_legacy_)
+                legacy_items_.emplace_back(node, item_start_);
+            else if (node.IsMap())
+                on_proxy_(node, item_start_);
+            return;
+        }
+        Frame &parent = stack_.back();
+        if (parent.node.IsSequence())
+            parent.node.push_back(node);
+        else if (!parent.has_key) {
+            //Node::operator= writes through to the referenced node, reset() rebinds the handle
+            parent.key.reset(node);
+            parent.has_key = true;
+        } else {
+            parent.node.force_insert(parent.key, node);
+            parent.has_key = false;
+        }
+    }
+};
+
+static bool explodeClashContentLegacy(const std::string &sub, std::vector<Proxy> &nodes) {
+    std::string section;
+    bool has_section = regGetMatch(sub, R"(^(?:Proxy|proxies):$\s(?:(?:^ +?.*$| *?-.*$|)\s?)+)", 1, &section) == 0;
+    Node yamlnode = Load(has_section ? section : sub);
+    if (yamlnode.size() && (yamlnode["Proxy"].IsDefined() || yamlnode["proxies"].IsDefined())) {
+        explodeClash(yamlnode, nodes);
+        return true;
+    }
+    return false;
+}
+
+static bool explodeClashContent(const std::string &sub, std::vector<Proxy> &nodes, SubParseReuse *reuse) {
+    std::vector<Proxy> parsed;
+    std::vector<std::pair<std::string_view, size_t>> sources;
+    uint32_t index = nodes.size();
+    auto convert = [&](const Node &item, std::string_view source) {
+        //the text of an item using an alias does not cover everything it refers to
+        bool keyed = reuse && !source.empty() && source.find('*') == std::string_view::npos;
+        const Proxy *known = keyed ? reuse->find(source) : nullptr;
+        Proxy node;
+        if (known)
+            node = *known;
+        else if (!explodeClashProxy(item, node))
+            return;
+        node.Id = index++;
+        if (keyed)
+            sources.emplace_back(source, nodes.size() + parsed.size());
+        parsed.emplace_back(std::move(node));
+    };
+    //an item only ends where the next one starts, so each one is converted a step behind
+    std::optional<Node> pending;
+    size_t pending_start = 0;
+    ClashProxyStream handler([&](const Node &item, size_t start) {
+        if (pending && start >= pending_start && start <= sub.size())
+            convert(*pending, std::string_view(sub).substr(pending_start, start - pending_start));
+        else if (pending)
+            convert(*pending, {});
+        pending.emplace(item);
+        pending_start = start;
+    });
+
+    ViewStreamBuf buffer(sub.data(), sub.size());
+    std::istream stream(&buffer);
     try {
-        std::string pattern = "\"?(inbounds)\"?:";
-        if (!processed &&
-            regFind(sub, pattern)) {
-            pattern = "\"?(outbounds)\"?:";
-            if (regFind(sub, pattern)) {
-                pattern = "\"?(route)\"?:";
-                if (regFind(sub, pattern)) {
-                    rapidjson::Document document;
-                    document.Parse(sub.c_str());
-                    if (!document.HasParseError() || document.IsObject()) {
-                        rapidjson::Value &value = document["outbounds"];
-                        if (value.IsArray() && !value.Empty()) {
-                            explodeSingbox(value, nodes);
-                            processed = true;
-                        }
-                    }
-                }
+        Parser parser(stream);
+        parser.HandleNextDocument(handler);
+    } catch (ClashProxyStream::SectionEnd &) {
+    } catch (YAML::Exception &e) {
+        //the whole document must be valid YAML here, while the legacy path only loads the proxy section
+        writeLog(0, "Streaming Clash parse failed, falling back to full load: " + std::string(e.what()), LOG_LEVEL_VERBOSE);
+        return explodeClashContentLegacy(sub, nodes);
+    }
+    if (handler.unresolved())
+        return explodeClashContentLegacy(sub, nodes);
+    if (!handler.found())
+        return false;
+    if (pending)
+        convert(*pending, {});
+    for (auto &[source, position] : sources)
+        reuse->record(source, position);
+    nodes.insert(nodes.end(), std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
+    return true;
+}
+
+static bool explodeSingboxContent(const std::string &sub, std::vector<Proxy> &nodes) {
+    try {
+        rapidjson::Document document;
+        document.Parse(sub.c_str());
+        if (!document.HasParseError() || document.IsObject()) {
+            rapidjson::Value &value = document["outbounds"];
+            if (value.IsArray() && !value.Empty()) {
+                explodeSingbox(value, nodes);
+                return true;
             }
         }
     } catch (std::exception &e) {
         writeLog(LOG_TYPE_ERROR, e.what(), LOG_LEVEL_ERROR);
-        //writeLog(0, e.what(), LOG_LEVEL_DEBUG);
-        //ignore
         throw;
     }
-    //try to parse as surge configuration
-    if (!processed && explodeSurge(sub, nodes)) {
-        processed = true;
-    }
+    return false;
+}
 
-    //try to parse as normal subscription
-    if (!processed) {
-        sub = urlSafeBase64Decode(sub);
-        if (regFind(sub, "(vmess|shadowsocks|http|trojan)\\s*?=")) {
-            if (explodeSurge(sub, nodes))
-                return;
-        }
-        strstream << sub;
-        char delimiter =
-                count(sub.begin(), sub.end(), '\n') < 1 ? count(sub.begin(), sub.end(), '\r') < 1 ? ' ' : '\r' : '\n';
-        while (getline(strstream, strLink, delimiter)) {
-            Proxy node;
-            if (strLink.rfind('\r') != std::string::npos)
-                strLink.erase(strLink.size() - 1);
-            explode(strLink, node);
-            if (strLink.empty() || node.Type == ProxyType::Unknown) {
+/// link lists are split into chunks of at least this many lines before they are parsed on several threads
+static constexpr size_t link_chunk_size = 1024;
+
+struct ParsedLink {
+    std::string_view source;
+    Proxy node;
+};
+
+static void explodeLinks(const std::string &sub, std::vector<Proxy> &nodes, SubParseReuse *reuse) {
+    std::string decoded_text = urlSafeBase64Decode(sub);
+    /// the links are recorded as views, keep what they point into alive in the memo
+    const std::string &decoded = !reuse ? decoded_text : decoded_text == sub ? sub : reuse->keep(std::move(decoded_text));
+    if (regFind(decoded, "(vmess|shadowsocks|http|trojan)\\s*?=")) {
+        if (explodeSurge(decoded, nodes))
+            return;
+    }
+    char delimiter = decoded.find('\n') != std::string::npos ? '\n' : decoded.find('\r') != std::string::npos ? '\r' : ' ';
+    string_view_array links;
+    split(links, decoded, delimiter);
+
+    /// every chunk only reads the previous parse, the current one is recorded below in the original order
+    auto parse = [&](size_t first, size_t last, std::vector<ParsedLink> &parsed) {
+        parsed.reserve(last - first);
+        for (size_t i = first; i < last; i++) {
+            std::string_view link = links[i];
+            if (link.find('\r') != std::string_view::npos)
+                link.remove_suffix(1);
+            if (link.empty())
                 continue;
+            ParsedLink item;
+            item.source = link;
+            if (const Proxy *known = reuse ? reuse->find(link) : nullptr)
+                item.node = *known;
+            else {
+                explode(link, item.node);
+                if (item.node.Type == ProxyType::Unknown)
+                    continue;
             }
-            nodes.emplace_back(std::move(node));
+            parsed.emplace_back(std::move(item));
+        }
+    };
+
+    size_t chunk_count = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u),
+                                          links.size() / link_chunk_size);
+    std::vector<std::vector<ParsedLink>> chunks(std::max<size_t>(chunk_count, 1));
+    if (chunks.size() == 1)
+        parse(0, links.size(), chunks[0]);
+    else {
+        std::vector<std::future<void>> pending;
+        for (size_t i = 1; i < chunks.size(); i++) {
+            pending.emplace_back(std::async(std::launch::async, parse, links.size() * i / chunks.size(),
+                                            links.size() * (i + 1) / chunks.size(), std::ref(chunks[i])));
+        }
+        parse(0, links.size() / chunks.size(), chunks[0]);
+        for (auto &x: pending)
+            x.get();
+    }
+
+    for (std::vector<ParsedLink> &chunk: chunks) {
+        for (ParsedLink &x: chunk) {
+            if (reuse)
+                reuse->record(x.source, nodes.size());
+            nodes.emplace_back(std::move(x.node));
         }
     }
-}
\ No newline at end of file
+}
+
+static void explodeSub(const std::string &sub, std::vector<Proxy> &nodes, ConfType type, SubParseReuse *reuse) {
+    bool processed = false;
+
+    switch (type) {
+        case ConfType::SSD:
+            explodeSSD(sub, nodes);
+            return;
+        case ConfType::Clash:
+            processed = explodeClashContent(sub, nodes, reuse);
+            break;
+        case ConfType::SingBox:
+            processed = explodeSingboxContent(sub, nodes);
+            break;
+        case ConfType::SUB: {
+            size_t before = nodes.size();
+            explodeLinks(sub, nodes, reuse);
+            if (nodes.size() != before)
+                return;
+            /// nothing came out of it as a link list, try the configuration parsers like before sniffing
+            if (sub.find("proxies:") != std::string::npos || sub.find("Proxy:") != std::string::npos)
+                processed = explodeClashContent(sub, nodes, reuse);
+            if (!processed)
+                explodeSurge(sub, nodes);
+            return;
+        }
+        default:
+            break;
+    }
+
+    //try to parse as surge configuration
+    if (!processed && explodeSurge(sub, nodes))
+        processed = true;
+
+    //try to parse as normal subscription
+    if (!processed)
+        explodeLinks(sub, nodes, reuse);
+}
+
+void explodeSub(const std::string &sub, std::vector<Proxy> &nodes, ConfType type) {
+    explodeSub(sub, nodes, type, nullptr);
+}
+
+void explodeSub(const std::string &sub, std::vector<Proxy> &nodes) {
+    explodeSub(sub, nodes, sniffConfType(sub));
+}
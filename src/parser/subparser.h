@@ -1,7 +1,11 @@
 #ifndef SUBPARSER_H_INCLUDED
 #define SUBPARSER_H_INCLUDED
 
+#include <deque>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "config/proxy.h"
 
@@ -16,7 +20,10 @@ enum class ConfType {
     SOCKS,
     HTTP,
     SUB,
-    Local
+    Local,
+    SSD,
+    Clash,
+    SingBox
 };
 
 void hysteriaConstruct(Proxy &node, const std::string &group, const std::string &remarks, const std::string &add,
@@ -133,14 +140,35 @@ void explodeHysteria2(std::string hysteria2, Proxy &node);
 void explodeAnyTLS(std::string anytls, Proxy &node);
 
 /// Parse a link
-void explode(const std::string &link, Proxy &node);
+void explode(std::string_view link, Proxy &node);
 
 void explodeSSD(std::string link, std::vector<Proxy> &nodes);
 
-void explodeSub(std::string sub, std::vector<Proxy> &nodes);
+/// Classify a subscription body in one pass, SUB means a plain or base64 link list
+ConfType sniffConfType(const std::string &content);
+
+void explodeSub(const std::string &sub, std::vector<Proxy> &nodes, ConfType type);
+
+void explodeSub(const std::string &sub, std::vector<Proxy> &nodes);
 
 int explodeConf(const std::string &filepath, std::vector<Proxy> &nodes);
 
 int explodeConfContent(const std::string &content, std::vector<Proxy> &nodes);
 
+/// Nodes parsed from one version of a subscription body. Passing it back when the next
+/// version is parsed lets unchanged link lines and Clash proxy items reuse their nodes.
+struct SubParseMemo
+{
+    /// the parsed body first, then any text decoded from it, the entry keys point into these
+    std::deque<std::string> texts;
+    std::vector<Proxy> nodes;
+    /// source text of an entry -> index of its node in nodes
+    std::unordered_map<std::string_view, size_t> entries;
+
+    /// rough heap footprint, for bounding how many memos are kept around
+    size_t bytes() const;
+};
+
+int explodeConfContent(const std::string &content, std::vector<Proxy> &nodes, const SubParseMemo *previous, SubParseMemo &current);
+
 #endif // SUBPARSER_H_INCLUDED
@@ -1,5 +1,12 @@
 #include <string>
 #include <iostream>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <libcron/Cron.h>
 
 #include "config/crontask.h"
@@ -19,19 +26,120 @@ struct script_info
     std::string name;
     time_t begin_time = 0;
     time_t timeout = 0;
+    bool timed_out = false;
 };
 
 int timeout_checker(JSRuntime *rt, void *opaque)
 {
-    script_info info = *static_cast<script_info*>(opaque);
+    script_info &info = *static_cast<script_info*>(opaque);
+    if(info.timed_out)
+        return 1;
     if(info.timeout != 0 && time(NULL) >= info.begin_time + info.timeout) /// timeout reached
     {
         writeLog(0, "Script '" + info.name + "' has exceeded timeout " + std::to_string(info.timeout) + ", terminate now.", LOG_LEVEL_WARNING);
+        info.timed_out = true;
         return 1;
     }
     return 0;
 }
 
+/// Cron jobs run here instead of on the server loop that calls cron_tick(),
+/// so a long script neither delays other tasks nor the looper itself.
+class CronExecutor
+{
+public:
+    void submit(std::function<void()> job)
+    {
+        {
+            guarded_mutex guard(mutex_);
+            jobs_.emplace_back(std::move(job));
+            if(workers_ < max_workers && idle_ == 0)
+            {
+                workers_++;
+                std::thread([this] { work(); }).detach();
+            }
+        }
+        cv_.notify_one();
+    }
+
+private:
+    static constexpr size_t max_workers = 2;
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(true)
+        {
+            idle_++;
+            cv_.wait(lock, [this] { return !jobs_.empty(); });
+            idle_--;
+            std::function<void()> job = std::move(jobs_.front());
+            jobs_.pop_front();
+            lock.unlock();
+            job();
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> jobs_;
+    size_t workers_ = 0, idle_ = 0;
+};
+
+struct cron_task_state
+{
+    bool running = false;
+    time_t last_run = 0;
+    long long last_duration_ms = 0;
+    std::string last_result;
+    unsigned long long runs = 0, skipped = 0;
+};
+
+static std::mutex cron_state_mutex;
+static std::map<std::string, cron_task_state> cron_states;
+
+static CronExecutor &cron_executor()
+{
+    /// never destroyed: workers may still be inside a script when the process exits
+    static auto *executor = new CronExecutor();
+    return *executor;
+}
+
+static std::string run_cron_task(const CronTaskConfig &x)
+{
+    qjs::Runtime runtime;
+    qjs::Context context(runtime);
+    script_info info;
+    try
+    {
+        script_runtime_init(runtime);
+        script_context_init(context);
+        defer(script_cleanup(context);)
+        std::string proxy = parseProxy(global.proxyConfig);
+        std::string script = fetchFile(x.Path, proxy, global.cacheConfig);
+        if(script.empty())
+        {
+            writeLog(0, "Script '" + x.Name + "' run failed: file is empty or not exist!", LOG_LEVEL_WARNING);
+            return "not found";
+        }
+        if(x.Timeout > 0)
+        {
+            info.begin_time = time(NULL);
+            info.timeout = x.Timeout;
+            info.name = x.Name;
+            JS_SetInterruptHandler(JS_GetRuntime(context.ctx), timeout_checker, &info);
+        }
+        script_eval(context, script);
+    }
+    catch (qjs::exception)
+    {
+        script_print_stack(context);
+        return info.timed_out ? "timeout" : "failed";
+    }
+    return "success";
+}
+
 void refresh_schedule()
 {
     cron.clear_schedules();
@@ -39,34 +147,31 @@ void refresh_schedule()
     {
         cron.add_schedule(x.Name, x.CronExp, [=](auto &)
         {
-            qjs::Runtime runtime;
-            qjs::Context context(runtime);
-            try
             {
-                script_runtime_init(runtime);
-                script_context_init(context);
-                defer(script_cleanup(context);)
-                std::string proxy = parseProxy(global.proxyConfig);
-                std::string script = fetchFile(x.Path, proxy, global.cacheConfig);
-                if(script.empty())
+                guarded_mutex guard(cron_state_mutex);
+                cron_task_state &state = cron_states[x.Name];
+                if(state.running)
                 {
-                    writeLog(0, "Script '" + x.Name + "' run failed: file is empty or not exist!", LOG_LEVEL_WARNING);
+                    state.skipped++;
+                    writeLog(0, "Script '" + x.Name + "' is still running, skipping this run.", LOG_LEVEL_WARNING);
                     return;
                 }
-                script_info info;
-                if(x.Timeout > 0)
-                {
-                    info.begin_time = time(NULL);
-                    info.timeout = x.Timeout;
-                    info.name = x.Name;
-                    JS_SetInterruptHandler(JS_GetRuntime(context.ctx), timeout_checker, &info);
-                }
-                context.eval(script);
+                state.running = true;
             }
-            catch (qjs::exception)
+            cron_executor().submit([x]
             {
-                script_print_stack(context);
-            }
+                auto begin = std::chrono::steady_clock::now();
+                time_t started = time(NULL);
+                std::string result = run_cron_task(x);
+                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+                guarded_mutex guard(cron_state_mutex);
+                cron_task_state &state = cron_states[x.Name];
+                state.running = false;
+                state.last_run = started;
+                state.last_duration_ms = elapsed;
+                state.last_result = result;
+                state.runs++;
+            });
         });
     }
 }
@@ -101,6 +206,24 @@ std::string list_cron_schedule(RESPONSE_CALLBACK_ARGS)
         writer.String(x.CronExp.data());
         writer.Key("path");
         writer.String(x.Path.data());
+        guarded_mutex guard(cron_state_mutex);
+        auto iter = cron_states.find(x.Name);
+        if(iter != cron_states.end())
+        {
+            const cron_task_state &state = iter->second;
+            writer.Key("running");
+            writer.Bool(state.running);
+            writer.Key("runs");
+            writer.Uint64(state.runs);
+            writer.Key("skipped");
+            writer.Uint64(state.skipped);
+            writer.Key("last_run");
+            writer.Int64(state.last_run);
+            writer.Key("last_duration_ms");
+            writer.Int64(state.last_duration_ms);
+            writer.Key("last_result");
+            writer.String(state.last_result.data());
+        }
         writer.EndObject();
     }
     writer.EndArray();
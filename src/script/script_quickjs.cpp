@@ -1,5 +1,13 @@
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include <iostream>
 #include <quickjspp.hpp>
 #include <utility>
@@ -13,6 +21,7 @@
 #include "handler/webget.h"
 #include "handler/settings.h"
 #include "parser/config/proxy.h"
+#include "utils/logger.h"
 #include "utils/map_extra.h"
 #include "utils/system.h"
 #include "script_quickjs.h"
@@ -428,6 +437,277 @@ uint32_t currentTime()
     return time(nullptr);
 }
 
+namespace
+{
+    struct NodeField
+    {
+        const char *name;
+        JSValue (*get)(JSContext *ctx, const Proxy &n);
+    };
+
+    template<typename T>
+    JSValue wrap_field(JSContext *ctx, const T &value)
+    {
+        return qjs::js_traits<T>::wrap(ctx, value);
+    }
+
+#define NODE_FIELD(name, member) {name, [](JSContext *ctx, const Proxy &n) { return wrap_field(ctx, n.member); }}
+    const NodeField node_fields[] = {
+        NODE_FIELD("Type", Type),
+        NODE_FIELD("Id", Id),
+        NODE_FIELD("GroupId", GroupId),
+        NODE_FIELD("Group", Group),
+        NODE_FIELD("Remark", Remark),
+        NODE_FIELD("Server", Hostname),
+        {"Port", [](JSContext *ctx, const Proxy &n) { return JS_NewInt32(ctx, n.Port); }},
+
+        NODE_FIELD("Username", Username),
+        NODE_FIELD("Password", Password),
+        NODE_FIELD("EncryptMethod", EncryptMethod),
+        NODE_FIELD("Plugin", Plugin),
+        NODE_FIELD("PluginOption", PluginOption),
+        NODE_FIELD("Protocol", Protocol),
+        NODE_FIELD("ProtocolParam", ProtocolParam),
+        NODE_FIELD("OBFS", OBFS),
+        NODE_FIELD("OBFSParam", OBFSParam),
+        NODE_FIELD("UserId", UserId),
+
+        {"AlterId", [](JSContext *ctx, const Proxy &n) { return JS_NewInt32(ctx, n.AlterId); }},
+        NODE_FIELD("TransferProtocol", TransferProtocol),
+        NODE_FIELD("FakeType", FakeType),
+        NODE_FIELD("TLSSecure", TLSSecure),
+
+        NODE_FIELD("Host", Host),
+        NODE_FIELD("Path", Path),
+        NODE_FIELD("Edge", Edge),
+
+        NODE_FIELD("QUICSecure", QUICSecure),
+        NODE_FIELD("QUICSecret", QUICSecret),
+
+        NODE_FIELD("UDP", UDP),
+        NODE_FIELD("TCPFastOpen", TCPFastOpen),
+        NODE_FIELD("AllowInsecure", AllowInsecure),
+        NODE_FIELD("TLS13", TLS13),
+
+        {"SnellVersion", [](JSContext *ctx, const Proxy &n) { return JS_NewInt32(ctx, n.SnellVersion); }},
+        NODE_FIELD("ServerName", ServerName),
+
+        NODE_FIELD("SelfIP", SelfIP),
+        NODE_FIELD("SelfIPv6", SelfIPv6),
+        NODE_FIELD("PublicKey", PublicKey),
+        NODE_FIELD("PrivateKey", PrivateKey),
+        NODE_FIELD("PreSharedKey", PreSharedKey),
+        NODE_FIELD("DnsServers", DnsServers),
+        {"Mtu", [](JSContext *ctx, const Proxy &n) { return JS_NewUint32(ctx, n.Mtu); }},
+        NODE_FIELD("AllowedIPs", AllowedIPs),
+        {"KeepAlive", [](JSContext *ctx, const Proxy &n) { return JS_NewUint32(ctx, n.KeepAlive); }},
+        NODE_FIELD("TestUrl", TestUrl),
+        NODE_FIELD("ClientId", ClientId),
+    };
+#undef NODE_FIELD
+
+    JSClassID node_view_class_id = 0;
+    std::once_flag node_view_class_once;
+    thread_local std::vector<ScriptNodeScope*> node_scopes;
+
+    JSValue node_object(JSContext *ctx, const Proxy &n)
+    {
+        JSValue obj = JS_NewObjectProto(ctx, JS_NULL);
+        if(JS_IsException(obj))
+            return obj;
+        for(const NodeField &field : node_fields)
+            JS_DefinePropertyValueStr(ctx, obj, field.name, field.get(ctx, n), JS_PROP_C_W_E);
+        return obj;
+    }
+
+    /// a view's node, and the fields it no longer serves because the script replaced or deleted them
+    struct NodeView
+    {
+        const Proxy *node = nullptr;
+        std::bitset<std::size(node_fields)> hidden;
+    };
+
+    /// index into node_fields of a string property, or -1 if the property is no field
+    int node_field_index(JSContext *ctx, JSAtom prop)
+    {
+        JSValue name = JS_AtomToValue(ctx, prop);
+        int index = -1;
+        if(JS_IsString(name))
+        {
+            const char *str = JS_ToCString(ctx, name);
+            for(std::size_t i = 0; str && i < std::size(node_fields); i++)
+            {
+                if(strcmp(node_fields[i].name, str) == 0)
+                {
+                    index = static_cast<int>(i);
+                    break;
+                }
+            }
+            JS_FreeCString(ctx, str);
+        }
+        JS_FreeValue(ctx, name);
+        return index;
+    }
+
+    NodeView *node_view(JSValueConst obj)
+    {
+        return static_cast<NodeView*>(JS_GetOpaque(obj, node_view_class_id));
+    }
+
+    /// the fields are reported as plain own data properties, so Object.keys(), spread,
+    /// Object.assign(), hasOwnProperty() and JSON.stringify() see them like on a copy
+    int node_view_get_own_property(JSContext *ctx, JSPropertyDescriptor *desc, JSValueConst obj, JSAtom prop)
+    {
+        NodeView *view = node_view(obj);
+        int index = node_field_index(ctx, prop);
+        if(!view || index < 0 || view->hidden.test(index))
+            return 0;
+        if(!view->node)
+        {
+            JS_ThrowTypeError(ctx, "node is no longer available outside of the script call");
+            return -1;
+        }
+        if(desc)
+        {
+            desc->value = node_fields[index].get(ctx, *view->node);
+            if(JS_IsException(desc->value))
+                return -1;
+            desc->flags = JS_PROP_C_W_E;
+            desc->getter = JS_UNDEFINED;
+            desc->setter = JS_UNDEFINED;
+        }
+        return 1;
+    }
+
+    int node_view_get_own_property_names(JSContext *ctx, JSPropertyEnum **ptab, uint32_t *plen, JSValueConst obj)
+    {
+        NodeView *view = node_view(obj);
+        if(view && !view->node)
+        {
+            JS_ThrowTypeError(ctx, "node is no longer available outside of the script call");
+            return -1;
+        }
+        auto *tab = static_cast<JSPropertyEnum*>(js_malloc(ctx, sizeof(JSPropertyEnum) * std::size(node_fields)));
+        if(!tab)
+            return -1;
+        uint32_t len = 0;
+        for(std::size_t i = 0; view && i < std::size(node_fields); i++)
+        {
+            if(view->hidden.test(i))
+                continue;
+            tab[len].is_enumerable = true;
+            tab[len].atom = JS_NewAtom(ctx, node_fields[i].name);
+            len++;
+        }
+        *ptab = tab;
+        *plen = len;
+        return 0;
+    }
+
+    /// only reached while the field is still served by the view, an assigned one is an ordinary property
+    int node_view_delete_property(JSContext *ctx, JSValueConst obj, JSAtom prop)
+    {
+        NodeView *view = node_view(obj);
+        int index = node_field_index(ctx, prop);
+        if(view && index >= 0)
+            view->hidden.set(index);
+        return 1;
+    }
+
+    /// assigning to or redefining a field replaces it with an ordinary property, which keeps
+    /// the attributes it is not given, as it would on a copy
+    int node_view_define_own_property(JSContext *ctx, JSValueConst this_obj, JSAtom prop, JSValueConst val, JSValueConst getter, JSValueConst setter, int flags)
+    {
+        NodeView *view = node_view(this_obj);
+        int index = node_field_index(ctx, prop);
+        if(!view || index < 0 || view->hidden.test(index))
+            return JS_DefineProperty(ctx, this_obj, prop, val, getter, setter, flags | JS_PROP_NO_EXOTIC);
+        if(!view->node)
+        {
+            JS_ThrowTypeError(ctx, "node is no longer available outside of the script call");
+            return -1;
+        }
+        JSValue current = JS_UNDEFINED;
+        const bool accessor = flags & (JS_PROP_HAS_GET | JS_PROP_HAS_SET);
+        if(!accessor && !(flags & JS_PROP_HAS_VALUE))
+        {
+            current = node_fields[index].get(ctx, *view->node);
+            if(JS_IsException(current))
+                return -1;
+            val = current;
+            flags |= JS_PROP_HAS_VALUE;
+        }
+        if(!(flags & JS_PROP_HAS_CONFIGURABLE))
+            flags |= JS_PROP_HAS_CONFIGURABLE | JS_PROP_CONFIGURABLE;
+        if(!(flags & JS_PROP_HAS_ENUMERABLE))
+            flags |= JS_PROP_HAS_ENUMERABLE | JS_PROP_ENUMERABLE;
+        if(!accessor && !(flags & JS_PROP_HAS_WRITABLE))
+            flags |= JS_PROP_HAS_WRITABLE | JS_PROP_WRITABLE;
+        view->hidden.set(index);
+        int ret = JS_DefineProperty(ctx, this_obj, prop, val, getter, setter, flags | JS_PROP_NO_EXOTIC);
+        JS_FreeValue(ctx, current);
+        return ret;
+    }
+
+    void node_view_finalizer(JSRuntime *, JSValue val)
+    {
+        delete node_view(val);
+    }
+
+    JSClassExoticMethods node_view_exotic = [] {
+        JSClassExoticMethods methods {};
+        methods.get_own_property = &node_view_get_own_property;
+        methods.get_own_property_names = &node_view_get_own_property_names;
+        methods.delete_property = &node_view_delete_property;
+        methods.define_own_property = &node_view_define_own_property;
+        return methods;
+    }();
+
+    void script_node_init(qjs::Context &context)
+    {
+        JSContext *ctx = context.ctx;
+        JSRuntime *rt = JS_GetRuntime(ctx);
+        std::call_once(node_view_class_once, [] { JS_NewClassID(&node_view_class_id); });
+        if(!JS_IsRegisteredClass(rt, node_view_class_id))
+        {
+            JSClassDef def {};
+            def.class_name = "Node";
+            def.finalizer = &node_view_finalizer;
+            def.exotic = &node_view_exotic;
+            JS_NewClass(rt, node_view_class_id, &def);
+        }
+        JS_SetClassProto(ctx, node_view_class_id, JS_NewObject(ctx));
+    }
+}
+
+ScriptNodeScope::ScriptNodeScope(qjs::Context &context) : ctx_(context.ctx)
+{
+    node_scopes.push_back(this);
+}
+
+ScriptNodeScope::~ScriptNodeScope()
+{
+    node_scopes.pop_back();
+    for(JSValue &view : views_)
+    {
+        if(NodeView *state = node_view(view))
+            state->node = nullptr;
+        JS_FreeValue(ctx_, view);
+    }
+}
+
+JSValue script_wrap_node(JSContext *ctx, const Proxy &node) noexcept
+{
+    if(node_scopes.empty() || node_scopes.back()->ctx_ != ctx || !node_view_class_id)
+        return node_object(ctx, node);
+    JSValue view = JS_NewObjectClass(ctx, static_cast<int>(node_view_class_id));
+    if(JS_IsException(view))
+        return view;
+    JS_SetOpaque(view, new NodeView{&node, {}});
+    node_scopes.back()->views_.push_back(JS_DupValue(ctx, view));
+    return view;
+}
+
 int script_context_init(qjs::Context &context)
 {
     try
@@ -435,7 +715,7 @@ int script_context_init(qjs::Context &context)
         js_init_module_os(context.ctx, "os");
         js_init_module_std(context.ctx, "std");
         js_std_add_helpers(context.ctx, 0, nullptr);
-        context.eval(qjs_require_module, "<require>", JS_EVAL_TYPE_MODULE);
+        script_eval(context, qjs_require_module, "<require>", JS_EVAL_TYPE_MODULE);
         auto &module = context.addModule("interUtils");
         module.class_<qjs_fetch_Headers>("Headers")
             .constructor<>()
@@ -501,6 +781,7 @@ int script_context_init(qjs::Context &context)
             .fun<&Proxy::KeepAlive>("KeepAlive")
             .fun<&Proxy::TestUrl>("TestUrl")
             .fun<&Proxy::ClientId>("ClientId");
+        script_node_init(context);
         context.global().add<&makeDataURI>("makeDataURI")
             .add<&qjs_fetch>("fetch")
             .add<&base64Encode>("atob")
@@ -511,7 +792,7 @@ int script_context_init(qjs::Context &context)
             .add<&qjs_getUrlArg>("getUrlArg")
             .add<&fileGet>("fileGet")
             .add<&fileWrite>("fileWrite");
-        context.eval(R"(
+        script_eval(context, R"(
         import * as interUtils from 'interUtils'
         globalThis.Request = interUtils.Request
         globalThis.Response = interUtils.Response
@@ -547,3 +828,259 @@ void script_print_stack(qjs::Context &context)
     if((bool) exc["stack"])
         std::cerr << (std::string) exc["stack"] << std::endl;
 }
+
+namespace
+{
+    struct CompiledScript
+    {
+        std::string source;
+        std::string filename;
+        int flags = 0;
+        std::vector<uint8_t> bytecode;
+    };
+
+    constexpr std::size_t max_compiled_scripts = 256;
+    constexpr std::size_t max_idle_contexts = 4;
+
+    std::mutex compiled_scripts_mutex;
+    std::unordered_map<std::size_t, std::shared_ptr<const CompiledScript>> compiled_scripts;
+
+    std::size_t script_hash(std::string_view script, const char *filename, int flags)
+    {
+        std::size_t seed = std::hash<std::string_view>{}(script);
+        seed ^= std::hash<std::string_view>{}(filename) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed ^ static_cast<std::size_t>(flags);
+    }
+}
+
+struct ScriptContextLease::Slot
+{
+    qjs::Runtime runtime;
+    std::unique_ptr<qjs::Context> context;
+    std::uintptr_t stack_mark = 0;
+    bool reusable = true;
+
+    explicit Slot(std::uintptr_t mark) : stack_mark(mark)
+    {
+        script_runtime_init(runtime);
+        context = std::make_unique<qjs::Context>(runtime);
+        if(script_context_init(*context) != 0)
+            reusable = false;
+    }
+
+    ~Slot()
+    {
+        js_std_free_handlers(runtime.rt);
+        context.reset();
+    }
+
+    /// Replace the context with a fresh one on the same runtime, so nothing the last
+    /// user changed, globals, built-ins or prototypes alike, is seen by the next one.
+    bool reset()
+    {
+        if(JS_IsJobPending(runtime.rt))
+            return false;
+        js_std_free_handlers(runtime.rt);
+        context.reset();
+        JS_RunGC(runtime.rt);
+        script_runtime_init(runtime);
+        context = std::make_unique<qjs::Context>(runtime);
+        return script_context_init(*context) == 0;
+    }
+};
+
+/// Released slots wait in stale_slots with whatever the last user left in their context,
+/// script_context_prepare() rebuilds them into idle_slots outside of any request. A pooled
+/// slot saves creating a runtime, and a prepared one also the new context and the
+/// script_context_init() run, the compiled bytecode cache saves parsing JS either way.
+static thread_local std::vector<std::unique_ptr<ScriptContextLease::Slot>> idle_slots;
+static thread_local std::vector<std::unique_ptr<ScriptContextLease::Slot>> stale_slots;
+static thread_local std::vector<ScriptContextLease::Slot*> leased_slots;
+
+qjs::Runtime *ScriptContextLease::runtime() const
+{
+    return slot_ ? &slot_->runtime : nullptr;
+}
+
+qjs::Context *ScriptContextLease::context() const
+{
+    return slot_ ? slot_->context.get() : nullptr;
+}
+
+void ScriptContextLease::release()
+{
+    if(!slot_)
+        return;
+    std::unique_ptr<Slot> slot(std::exchange(slot_, nullptr));
+    auto iter = std::find(leased_slots.begin(), leased_slots.end(), slot.get());
+    if(iter == leased_slots.end())
+        return;
+    leased_slots.erase(iter);
+    if(slot->reusable && idle_slots.size() + stale_slots.size() < max_idle_contexts)
+        stale_slots.push_back(std::move(slot));
+}
+
+ScriptContextLease script_context_acquire()
+{
+    /// QuickJS measures stack usage from where the runtime was created, so a pooled
+    /// runtime may only be used at the same or a deeper stack position on its own thread.
+    volatile char probe = 0;
+    auto mark = reinterpret_cast<std::uintptr_t>(&probe);
+    auto usable = [mark](const auto &x) { return x->stack_mark >= mark; };
+    std::unique_ptr<ScriptContextLease::Slot> slot;
+    auto iter = std::find_if(idle_slots.begin(), idle_slots.end(), usable);
+    if(iter != idle_slots.end())
+    {
+        slot = std::move(*iter);
+        idle_slots.erase(iter);
+    }
+    else if((iter = std::find_if(stale_slots.begin(), stale_slots.end(), usable)) != stale_slots.end())
+    {
+        /// nothing was prepared in between, rebuild it here, which still skips creating a runtime
+        slot = std::move(*iter);
+        stale_slots.erase(iter);
+        if(!slot->reset())
+            slot = std::make_unique<ScriptContextLease::Slot>(mark);
+    }
+    else
+        slot = std::make_unique<ScriptContextLease::Slot>(mark);
+    leased_slots.push_back(slot.get());
+    return ScriptContextLease(slot.release());
+}
+
+void script_context_prepare()
+{
+    while(!stale_slots.empty())
+    {
+        std::unique_ptr<ScriptContextLease::Slot> slot = std::move(stale_slots.back());
+        stale_slots.pop_back();
+        if(slot->reset())
+            idle_slots.push_back(std::move(slot));
+    }
+}
+
+void script_eval(qjs::Context &context, std::string_view script, const char *filename, int flags)
+{
+    JSContext *ctx = context.ctx;
+    std::size_t key = script_hash(script, filename, flags);
+    std::shared_ptr<const CompiledScript> compiled;
+    {
+        guarded_mutex guard(compiled_scripts_mutex);
+        auto iter = compiled_scripts.find(key);
+        if(iter != compiled_scripts.end() && iter->second->source == script && iter->second->filename == filename && iter->second->flags == flags)
+            compiled = iter->second;
+    }
+
+    JSValue function;
+    if(compiled)
+    {
+        function = JS_ReadObject(ctx, compiled->bytecode.data(), compiled->bytecode.size(), JS_READ_OBJ_BYTECODE);
+        if(JS_IsException(function))
+            throw qjs::exception{ctx};
+    }
+    else
+    {
+        /// JS_Eval() wants a terminated source, which a view does not promise
+        std::string source(script);
+        function = JS_Eval(ctx, source.data(), source.size(), filename, flags | JS_EVAL_FLAG_COMPILE_ONLY);
+        if(JS_IsException(function))
+            throw qjs::exception{ctx};
+        std::size_t size = 0;
+        uint8_t *buffer = JS_WriteObject(ctx, &size, function, JS_WRITE_OBJ_BYTECODE);
+        if(buffer)
+        {
+            auto entry = std::make_shared<CompiledScript>();
+            entry->source = std::move(source);
+            entry->filename = filename;
+            entry->flags = flags;
+            entry->bytecode.assign(buffer, buffer + size);
+            js_free(ctx, buffer);
+            guarded_mutex guard(compiled_scripts_mutex);
+            if(compiled_scripts.size() >= max_compiled_scripts)
+                compiled_scripts.clear();
+            compiled_scripts[key] = std::move(entry);
+        }
+        else
+            JS_FreeValue(ctx, JS_GetException(ctx));
+    }
+
+    /// modules read back from bytecode, or compiled on their own, still have to be linked to their imports
+    if(JS_VALUE_GET_TAG(function) == JS_TAG_MODULE && JS_ResolveModule(ctx, function) < 0)
+    {
+        JS_FreeValue(ctx, function);
+        throw qjs::exception{ctx};
+    }
+    qjs::Value result{ctx, JS_EvalFunction(ctx, function)};
+}
+
+namespace
+{
+    std::mutex script_stats_mutex;
+    std::map<std::string, ScriptStats> script_stats;
+    thread_local ScriptBudget *active_budget = nullptr;
+}
+
+ScriptBudget::ScriptBudget(qjs::Context &context, const char *name) : rt_(JS_GetRuntime(context.ctx)), name_(name), previous_(active_budget)
+{
+    begin_ = std::chrono::steady_clock::now();
+    deadline_ = begin_ + std::chrono::milliseconds(global.scriptTimeout);
+    active_budget = this;
+    install();
+}
+
+ScriptBudget::~ScriptBudget()
+{
+    active_budget = previous_;
+    if(previous_ && previous_->rt_ == rt_)
+        previous_->install();
+    else
+    {
+        JS_SetInterruptHandler(rt_, nullptr, nullptr);
+        JS_SetMemoryLimit(rt_, static_cast<size_t>(-1));
+    }
+
+    auto elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin_).count());
+    guarded_mutex guard(script_stats_mutex);
+    ScriptStats &stats = script_stats[name_];
+    stats.runs++;
+    stats.total_ms += elapsed;
+    stats.max_ms = std::max(stats.max_ms, elapsed);
+    if(timed_out_)
+        stats.timeouts++;
+}
+
+void ScriptBudget::install()
+{
+    if(global.scriptTimeout > 0)
+        JS_SetInterruptHandler(rt_, &ScriptBudget::interrupt, this);
+    else
+        JS_SetInterruptHandler(rt_, nullptr, nullptr);
+    if(global.scriptMemoryLimit > 0)
+        JS_SetMemoryLimit(rt_, static_cast<size_t>(global.scriptMemoryLimit) * 1024 * 1024);
+    else
+        JS_SetMemoryLimit(rt_, static_cast<size_t>(-1));
+}
+
+int ScriptBudget::interrupt(JSRuntime *, void *opaque)
+{
+    auto *budget = static_cast<ScriptBudget*>(opaque);
+    if(budget->timed_out_)
+        return 1;
+    if(std::chrono::steady_clock::now() < budget->deadline_)
+        return 0;
+    budget->timed_out_ = true;
+    writeLog(0, std::string("Script '") + budget->name_ + "' has exceeded timeout " + std::to_string(global.scriptTimeout) + "ms, terminate now.", LOG_LEVEL_WARNING);
+    return 1;
+}
+
+std::vector<ScriptStats> scriptStats()
+{
+    std::vector<ScriptStats> result;
+    guarded_mutex guard(script_stats_mutex);
+    for(auto &x : script_stats)
+    {
+        result.push_back(x.second);
+        result.back().name = x.first;
+    }
+    return result;
+}
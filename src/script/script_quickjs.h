@@ -6,12 +6,106 @@
 
 #ifndef NO_JS_RUNTIME
 
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include <quickjspp.hpp>
 
 void script_runtime_init(qjs::Runtime &runtime);
 int script_context_init(qjs::Context &context);
 int script_cleanup(qjs::Context &context);
 void script_print_stack(qjs::Context &context);
+void script_eval(qjs::Context &context, std::string_view script, const char *filename = "<eval>", int flags = JS_EVAL_TYPE_GLOBAL);
+
+/// Exclusive use of a pre-initialized runtime and context from the per-thread pool.
+/// A released context goes back to the pool as it is, it is only replaced with a
+/// fresh one by script_context_prepare(), or on the next acquire if that did not run.
+class ScriptContextLease
+{
+public:
+    struct Slot;
+
+    ScriptContextLease() = default;
+    explicit ScriptContextLease(Slot *slot) : slot_(slot) {}
+    ScriptContextLease(ScriptContextLease &&other) noexcept : slot_(std::exchange(other.slot_, nullptr)) {}
+    ScriptContextLease(const ScriptContextLease&) = delete;
+    ~ScriptContextLease() { release(); }
+
+    ScriptContextLease &operator=(ScriptContextLease &&other) noexcept
+    {
+        if(this != &other)
+        {
+            release();
+            slot_ = std::exchange(other.slot_, nullptr);
+        }
+        return *this;
+    }
+
+    explicit operator bool() const { return slot_ != nullptr; }
+    qjs::Runtime *runtime() const;
+    qjs::Context *context() const;
+    void release();
+
+private:
+    Slot *slot_ = nullptr;
+};
+
+ScriptContextLease script_context_acquire();
+/// Rebuild the contexts released on this thread, for a worker to call when it is idle.
+void script_context_prepare();
+
+/// While a scope is active on a context, nodes passed to script functions are
+/// exposed as views that read each field from the C++ node when it is accessed,
+/// instead of being copied into a new object. Views are detached when the scope
+/// ends, so the nodes they point to only need to outlive the scope.
+class ScriptNodeScope
+{
+public:
+    explicit ScriptNodeScope(qjs::Context &context);
+    ScriptNodeScope(const ScriptNodeScope&) = delete;
+    ~ScriptNodeScope();
+
+private:
+    friend JSValue script_wrap_node(JSContext *ctx, const Proxy &node) noexcept;
+
+    JSContext *ctx_;
+    std::vector<JSValue> views_;
+};
+
+JSValue script_wrap_node(JSContext *ctx, const Proxy &node) noexcept;
+
+/// Bounds one request-path script run by script_timeout and script_memory_limit,
+/// and adds its run time to the statistics of the given script kind.
+class ScriptBudget
+{
+public:
+    ScriptBudget(qjs::Context &context, const char *name);
+    ScriptBudget(const ScriptBudget&) = delete;
+    ~ScriptBudget();
+
+private:
+    static int interrupt(JSRuntime *rt, void *opaque);
+    void install();
+
+    JSRuntime *rt_;
+    const char *name_;
+    std::chrono::steady_clock::time_point begin_, deadline_;
+    ScriptBudget *previous_;
+    bool timed_out_ = false;
+};
+
+struct ScriptStats
+{
+    std::string name;
+    uint64_t runs = 0;
+    uint64_t total_ms = 0;
+    uint64_t max_ms = 0;
+    uint64_t timeouts = 0;
+};
+
+std::vector<ScriptStats> scriptStats();
 
 inline JSValue JS_NewString(JSContext *ctx, const std::string& str)
 {
@@ -89,62 +183,7 @@ namespace qjs
     {
         static JSValue wrap(JSContext *ctx, const Proxy &n) noexcept
         {
-            JSValue obj = JS_NewObjectProto(ctx, JS_NULL);
-            if (JS_IsException(obj)) {
-                return obj;
-            }
-
-            JS_DefinePropertyValueStr(ctx, obj, "Type", js_traits<ProxyType>::wrap(ctx, n.Type), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "Id", JS_NewUint32(ctx, n.Id), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "GroupId", JS_NewUint32(ctx, n.GroupId), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "Group", JS_NewString(ctx, n.Group), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "Remark", JS_NewString(ctx, n.Remark), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "Server", JS_NewString(ctx, n.Hostname), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "Port", JS_NewInt32(ctx, n.Port), JS_PROP_C_W_E);
-
-            JS_DefinePropertyValueStr(ctx, obj, "Username", JS_NewString(ctx, n.Username), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "Password", JS_NewString(ctx, n.Password), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "EncryptMethod", JS_NewString(ctx, n.EncryptMethod), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "Plugin", JS_NewString(ctx, n.Plugin), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "PluginOption", JS_NewString(ctx, n.PluginOption), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "Protocol", JS_NewString(ctx, n.Protocol), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "ProtocolParam", JS_NewString(ctx, n.ProtocolParam), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "OBFS", JS_NewString(ctx, n.OBFS), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "OBFSParam", JS_NewString(ctx, n.OBFSParam), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "UserId", JS_NewString(ctx, n.UserId), JS_PROP_C_W_E);
-
-            JS_DefinePropertyValueStr(ctx, obj, "AlterId", JS_NewInt32(ctx, n.AlterId), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "TransferProtocol", JS_NewString(ctx, n.TransferProtocol), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "FakeType", JS_NewString(ctx, n.FakeType), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "TLSSecure", JS_NewBool(ctx, n.TLSSecure), JS_PROP_C_W_E);
-
-            JS_DefinePropertyValueStr(ctx, obj, "Host", JS_NewString(ctx, n.Host), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "Path", JS_NewString(ctx, n.Path), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "Edge", JS_NewString(ctx, n.Edge), JS_PROP_C_W_E);
-
-            JS_DefinePropertyValueStr(ctx, obj, "QUICSecure", JS_NewString(ctx, n.QUICSecure), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "QUICSecret", JS_NewString(ctx, n.QUICSecret), JS_PROP_C_W_E);
-
-            JS_DefinePropertyValueStr(ctx, obj, "UDP", js_traits<tribool>::wrap(ctx, n.UDP), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "TCPFastOpen", js_traits<tribool>::wrap(ctx, n.TCPFastOpen), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "AllowInsecure", js_traits<tribool>::wrap(ctx, n.AllowInsecure), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "TLS13", js_traits<tribool>::wrap(ctx, n.TLS13), JS_PROP_C_W_E);
-
-            JS_DefinePropertyValueStr(ctx, obj, "SnellVersion", JS_NewInt32(ctx, n.SnellVersion), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "ServerName", JS_NewString(ctx, n.ServerName), JS_PROP_C_W_E);
-
-            JS_DefinePropertyValueStr(ctx, obj, "SelfIP", JS_NewString(ctx, n.SelfIP), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "SelfIPv6", JS_NewString(ctx, n.SelfIPv6), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "PublicKey", JS_NewString(ctx, n.PublicKey), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "PrivateKey", JS_NewString(ctx, n.PrivateKey), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "PreSharedKey", JS_NewString(ctx, n.PreSharedKey), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "DnsServers", js_traits<StringArray>::wrap(ctx, n.DnsServers), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "Mtu", JS_NewUint32(ctx, n.Mtu), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "AllowedIPs", JS_NewString(ctx, n.AllowedIPs), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "KeepAlive", JS_NewUint32(ctx, n.KeepAlive), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "TestUrl", JS_NewString(ctx, n.TestUrl), JS_PROP_C_W_E);
-            JS_DefinePropertyValueStr(ctx, obj, "ClientId", JS_NewString(ctx, n.ClientId), JS_PROP_C_W_E);
-            return obj;
+            return script_wrap_node(ctx, n);
         }
 
         static Proxy unwrap(JSContext *ctx, JSValueConst v)
@@ -203,23 +242,35 @@ namespace qjs
             return node;
         }
     };
+
+    template<>
+    struct js_traits<ProxyRefs>
+    {
+        static JSValue wrap(JSContext *ctx, const ProxyRefs &arr) noexcept
+        {
+            JSValue jsArray = JS_NewArray(ctx);
+            for (std::size_t i = 0; i < arr.size(); i++) {
+                JS_SetPropertyUint32(ctx, jsArray, i, js_traits<Proxy>::wrap(ctx, *arr[i]));
+            }
+            return jsArray;
+        }
+    };
 }
 
 template <typename Fn>
-void script_safe_runner(qjs::Runtime *runtime, qjs::Context *context, Fn runnable, bool clean_context = false)
+void script_safe_runner(qjs::Runtime *runtime, qjs::Context *context, Fn runnable, bool clean_context = false, const char *name = "script")
 {
-    qjs::Runtime *internal_runtime = runtime;
-    qjs::Context *internal_context = context;
-    defer(if(clean_context) {delete internal_context; delete internal_runtime;} )
+    ScriptContextLease lease;
     if(clean_context)
     {
-        internal_runtime = new qjs::Runtime();
-        script_runtime_init(*internal_runtime);
-        internal_context = new qjs::Context(*internal_runtime);
-        script_context_init(*internal_context);
+        lease = script_context_acquire();
+        runtime = lease.runtime();
+        context = lease.context();
     }
-    if(internal_runtime && internal_context)
-        runnable(*internal_context);
+    if(!runtime || !context)
+        return;
+    ScriptBudget budget(*context, name);
+    runnable(*context);
 }
 
 #else
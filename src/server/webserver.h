@@ -38,6 +38,7 @@ struct listener_args
     int max_workers;
     void (*looper_callback)() = nullptr;
     uint32_t looper_interval = 200;
+    void (*worker_idle_callback)() = nullptr; //run on a worker thread after each connection it served
 };
 
 struct responseRoute
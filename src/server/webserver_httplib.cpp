@@ -26,6 +26,25 @@ static inline bool is_request_header_blacklisted(const std::string &header)
     return false;
 }
 
+/// thread pool that lets a worker do deferred housekeeping once a connection is done with
+class IdleHookThreadPool : public httplib::ThreadPool
+{
+public:
+    IdleHookThreadPool(size_t n, void (*hook)()) : ThreadPool(n), hook_(hook) {}
+
+    void enqueue(std::function<void()> fn) override
+    {
+        ThreadPool::enqueue([hook = hook_, fn = std::move(fn)]
+        {
+            fn();
+            hook();
+        });
+    }
+
+private:
+    void (*hook_)();
+};
+
 void WebServer::stop_web_server()
 {
     SERVER_EXIT_FLAG = true;
@@ -220,7 +239,9 @@ int WebServer::start_web_server_multi(listener_args *args)
     {
         server.set_mount_point("/", serve_file_root);
     }
-    server.new_task_queue = [args] {
+    server.new_task_queue = [args]() -> httplib::TaskQueue* {
+        if (args->worker_idle_callback)
+            return new IdleHookThreadPool(args->max_workers, args->worker_idle_callback);
         return new httplib::ThreadPool(args->max_workers);
     };
     server.bind_to_port(args->listen_address, args->port, 0);
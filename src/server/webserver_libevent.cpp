@@ -147,7 +147,8 @@ static int process_request(WebServer *server, Request &request, Response &respon
             try
             {
                 return_data = rc(request, response);
-                response.content_type = x.content_type;
+                if(response.content_type.empty())
+                    response.content_type = x.content_type;
             }
             catch(std::exception &e)
             {
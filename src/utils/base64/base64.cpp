@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstdint>
 #include <string>
 
 #include "utils/string.h"
@@ -7,87 +9,330 @@ static const std::string base64_chars =
     "abcdefghijklmnopqrstuvwxyz"
     "0123456789+/";
 
-std::string base64Encode(const std::string &string_to_encode)
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BASE64_X86_SIMD
+#include <immintrin.h>
+
+/// SIMD kernels only handle whole blocks of plain base64 text, everything else
+/// (line breaks, padding, garbage, tails) is left to the scalar loops below.
+
+enum class Base64Kernel
 {
-    char const* bytes_to_encode = string_to_encode.data();
-    unsigned int in_len = string_to_encode.size();
+    Scalar,
+    SSE41,
+    AVX2
+};
 
-    std::string ret;
-    int i = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
+static Base64Kernel base64DetectKernel()
+{
+    static const Base64Kernel kernel = []
+    {
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+            return Base64Kernel::AVX2;
+        if(__builtin_cpu_supports("sse4.1"))
+            return Base64Kernel::SSE41;
+        return Base64Kernel::Scalar;
+    }();
+    return kernel;
+}
+
+#ifdef BASE64_KERNEL_SELECT
+/// set by the SIMD equivalence test: 0 scalar, 1 SSE4.1, 2 AVX2, capped at what the CPU supports
+int base64_selected_kernel = -1;
+#endif // BASE64_KERNEL_SELECT
+
+static Base64Kernel base64Kernel()
+{
+#ifdef BASE64_KERNEL_SELECT
+    if(base64_selected_kernel >= 0)
+        return static_cast<Base64Kernel>(std::min(base64_selected_kernel, static_cast<int>(base64DetectKernel())));
+#endif // BASE64_KERNEL_SELECT
+    return base64DetectKernel();
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i base64EncodeIndicesSSE(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    const __m128i idx = _mm_or_si128(t1, t3);
+
+    __m128i offset = _mm_set1_epi8('A');
+    offset = _mm_blendv_epi8(offset, _mm_set1_epi8('a' - 26), _mm_cmpgt_epi8(idx, _mm_set1_epi8(25)));
+    offset = _mm_blendv_epi8(offset, _mm_set1_epi8('0' - 52), _mm_cmpgt_epi8(idx, _mm_set1_epi8(51)));
+    offset = _mm_blendv_epi8(offset, _mm_set1_epi8('+' - 62), _mm_cmpeq_epi8(idx, _mm_set1_epi8(62)));
+    offset = _mm_blendv_epi8(offset, _mm_set1_epi8('/' - 63), _mm_cmpeq_epi8(idx, _mm_set1_epi8(63)));
+    return _mm_add_epi8(idx, offset);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i base64EncodeIndicesAVX2(__m256i in)
+{
+    in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                                 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i idx = _mm256_or_si256(t1, t3);
+
+    __m256i offset = _mm256_set1_epi8('A');
+    offset = _mm256_blendv_epi8(offset, _mm256_set1_epi8('a' - 26), _mm256_cmpgt_epi8(idx, _mm256_set1_epi8(25)));
+    offset = _mm256_blendv_epi8(offset, _mm256_set1_epi8('0' - 52), _mm256_cmpgt_epi8(idx, _mm256_set1_epi8(51)));
+    offset = _mm256_blendv_epi8(offset, _mm256_set1_epi8('+' - 62), _mm256_cmpeq_epi8(idx, _mm256_set1_epi8(62)));
+    offset = _mm256_blendv_epi8(offset, _mm256_set1_epi8('/' - 63), _mm256_cmpeq_epi8(idx, _mm256_set1_epi8(63)));
+    return _mm256_add_epi8(idx, offset);
+}
 
-    while (in_len--)
+/// encode whole 12-byte groups, reads 16 bytes per group and writes 16 characters
+__attribute__((target("sse4.1")))
+static string_size base64EncodeBlocksSSE(const unsigned char *src, string_size len, char *dst)
+{
+    string_size consumed = 0;
+    while(len - consumed >= 16)
     {
-        char_array_3[i++] = *(bytes_to_encode++);
-        if (i == 3)
-        {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + consumed));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), base64EncodeIndicesSSE(in));
+        dst += 16;
+        consumed += 12;
+    }
+    return consumed;
+}
 
-            for(i = 0; (i <4) ; i++)
-                ret += base64_chars[char_array_4[i]];
-            i = 0;
+/// encode whole 24-byte groups, reads 28 bytes per group and writes 32 characters
+__attribute__((target("avx2")))
+static string_size base64EncodeBlocksAVX2(const unsigned char *src, string_size len, char *dst)
+{
+    string_size consumed = 0;
+    while(len - consumed >= 28)
+    {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + consumed));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + consumed + 12));
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), base64EncodeIndicesAVX2(in));
+        dst += 32;
+        consumed += 24;
+    }
+    return consumed;
+}
+
+/// map base64 characters to their 6-bit values, fails if any byte is outside the alphabet
+__attribute__((target("sse4.1")))
+static inline bool base64DecodeValuesSSE(__m128i in, bool accept_urlsafe, __m128i &values)
+{
+    const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('Z' + 1)));
+    const __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('z' + 1)));
+    const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('9' + 1)));
+    const __m128i plus = _mm_cmpeq_epi8(in, _mm_set1_epi8('+'));
+    const __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+    __m128i shift = _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')), _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+    shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+    if(accept_urlsafe)
+    {
+        const __m128i dash = _mm_cmpeq_epi8(in, _mm_set1_epi8('-'));
+        const __m128i under = _mm_cmpeq_epi8(in, _mm_set1_epi8('_'));
+        valid = _mm_or_si128(valid, _mm_or_si128(dash, under));
+        shift = _mm_or_si128(shift, _mm_and_si128(dash, _mm_set1_epi8(62 - '-')));
+        shift = _mm_or_si128(shift, _mm_and_si128(under, _mm_set1_epi8(63 - '_')));
+    }
+    if(_mm_movemask_epi8(valid) != 0xFFFF)
+        return false;
+    values = _mm_add_epi8(in, shift);
+    return true;
+}
+
+__attribute__((target("avx2")))
+static inline bool base64DecodeValuesAVX2(__m256i in, bool accept_urlsafe, __m256i &values)
+{
+    const __m256i upper = _mm256_andnot_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('Z')), _mm256_cmpgt_epi8(in, _mm256_set1_epi8('A' - 1)));
+    const __m256i lower = _mm256_andnot_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('z')), _mm256_cmpgt_epi8(in, _mm256_set1_epi8('a' - 1)));
+    const __m256i digit = _mm256_andnot_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('9')), _mm256_cmpgt_epi8(in, _mm256_set1_epi8('0' - 1)));
+    const __m256i plus = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+'));
+    const __m256i slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+
+    __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(plus, slash)));
+    __m256i shift = _mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-'A')), _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(plus, _mm256_set1_epi8(62 - '+')));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(slash, _mm256_set1_epi8(63 - '/')));
+    if(accept_urlsafe)
+    {
+        const __m256i dash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('-'));
+        const __m256i under = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('_'));
+        valid = _mm256_or_si256(valid, _mm256_or_si256(dash, under));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(dash, _mm256_set1_epi8(62 - '-')));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(under, _mm256_set1_epi8(63 - '_')));
+    }
+    if(static_cast<uint32_t>(_mm256_movemask_epi8(valid)) != 0xFFFFFFFFu)
+        return false;
+    values = _mm256_add_epi8(in, shift);
+    return true;
+}
+
+/// decode whole 16-character groups until one contains a non-alphabet byte, writes 16 bytes per 12 decoded
+__attribute__((target("sse4.1")))
+static string_size base64DecodeBlocksSSE(const unsigned char *src, string_size len, unsigned char *dst, bool accept_urlsafe)
+{
+    string_size consumed = 0;
+    __m128i values;
+    while(len - consumed >= 16 && base64DecodeValuesSSE(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + consumed)), accept_urlsafe, values))
+    {
+        const __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        const __m128i out = _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), out);
+        dst += 12;
+        consumed += 16;
+    }
+    return consumed;
+}
+
+/// decode whole 32-character groups until one contains a non-alphabet byte, writes 32 bytes per 24 decoded
+__attribute__((target("avx2")))
+static string_size base64DecodeBlocksAVX2(const unsigned char *src, string_size len, unsigned char *dst, bool accept_urlsafe)
+{
+    string_size consumed = 0;
+    __m256i values;
+    while(len - consumed >= 32 && base64DecodeValuesAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + consumed)), accept_urlsafe, values))
+    {
+        const __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        const __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        __m256i out = _mm256_shuffle_epi8(packed, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                                   2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        out = _mm256_permutevar8x32_epi32(out, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), out);
+        dst += 24;
+        consumed += 32;
+    }
+    return consumed;
+}
+#endif // BASE64_X86_SIMD
+
+static string_size base64EncodeBlocks(const unsigned char *src, string_size len, char *dst)
+{
+#ifdef BASE64_X86_SIMD
+    switch(base64Kernel())
+    {
+    case Base64Kernel::AVX2:
+        {
+            string_size consumed = base64EncodeBlocksAVX2(src, len, dst);
+            return consumed + base64EncodeBlocksSSE(src + consumed, len - consumed, dst + consumed / 3 * 4);
         }
+    case Base64Kernel::SSE41:
+        return base64EncodeBlocksSSE(src, len, dst);
+    default:
+        break;
     }
+#endif // BASE64_X86_SIMD
+    return 0;
+}
 
-    if (i)
+static string_size base64DecodeBlocks(const unsigned char *src, string_size len, unsigned char *dst, bool accept_urlsafe)
+{
+#ifdef BASE64_X86_SIMD
+    switch(base64Kernel())
     {
-        int j;
-        for(j = i; j < 3; j++)
-            char_array_3[j] = '\0';
+    case Base64Kernel::AVX2:
+        return base64DecodeBlocksAVX2(src, len, dst, accept_urlsafe);
+    case Base64Kernel::SSE41:
+        return base64DecodeBlocksSSE(src, len, dst, accept_urlsafe);
+    default:
+        break;
+    }
+#endif // BASE64_X86_SIMD
+    return 0;
+}
+
+std::string base64Encode(const std::string &string_to_encode)
+{
+    auto bytes_to_encode = reinterpret_cast<const unsigned char*>(string_to_encode.data());
+    string_size in_len = string_to_encode.size();
 
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-        char_array_4[3] = char_array_3[2] & 0x3f;
+    std::string ret;
+    ret.resize((in_len + 2) / 3 * 4);
+    string_size in_ = base64EncodeBlocks(bytes_to_encode, in_len, ret.data());
+    string_size out = in_ / 3 * 4;
 
-        for (j = 0; (j < i + 1); j++)
-            ret += base64_chars[char_array_4[j]];
+    for(; in_len - in_ >= 3; in_ += 3)
+    {
+        const unsigned char *char_array_3 = bytes_to_encode + in_;
+        ret[out++] = base64_chars[(char_array_3[0] & 0xfc) >> 2];
+        ret[out++] = base64_chars[((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4)];
+        ret[out++] = base64_chars[((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6)];
+        ret[out++] = base64_chars[char_array_3[2] & 0x3f];
+    }
 
-        while((i++ < 3))
-            ret += '=';
+    if(in_ < in_len)
+    {
+        unsigned char char_array_3[3] = {0, 0, 0};
+        string_size i = in_len - in_;
+        for(string_size j = 0; j < i; j++)
+            char_array_3[j] = bytes_to_encode[in_ + j];
 
+        ret[out++] = base64_chars[(char_array_3[0] & 0xfc) >> 2];
+        ret[out++] = base64_chars[((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4)];
+        ret[out++] = i == 2 ? base64_chars[((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6)] : '=';
+        ret[out++] = '=';
     }
 
     return ret;
-
 }
 
 std::string base64Decode(const std::string &encoded_string, bool accept_urlsafe)
 {
+    struct DecodeTables
+    {
+        unsigned char dtable[256] = {}, itable[256] = {};
+        DecodeTables()
+        {
+            for (string_size k = 0; k < base64_chars.length(); k++)
+            {
+                unsigned char uchar = base64_chars[k];
+                dtable[uchar] = k;  // decode (find)
+                itable[uchar] = 1;  // is_base64
+            }
+            const unsigned char dash = '-', add = '+', under = '_', slash = '/';
+            // Add urlsafe table
+            dtable[dash] = dtable[add]; itable[dash] = 2;
+            dtable[under] = dtable[slash]; itable[under] = 2;
+        }
+    };
+    static const DecodeTables tables;
+    const unsigned char *dtable = tables.dtable, *itable = tables.itable;
+
+    auto src = reinterpret_cast<const unsigned char*>(encoded_string.data());
     string_size in_len = encoded_string.size();
     string_size i = 0;
-    string_size in_ = 0;
+    string_size in_ = 0, out = 0;
     unsigned char char_array_4[4], char_array_3[3], uchar;
-    static unsigned char dtable[256], itable[256], table_ready = 0;
     std::string ret;
 
-    // Should not need thread_local with the flag...
-    if (!table_ready)
+    /// every input byte yields at most one output byte, so the input size bounds the output
+    ret.resize(in_len);
+    auto dst = reinterpret_cast<unsigned char*>(ret.data());
+
+    while (in_ < in_len && src[in_] != '=')
     {
-        // No memset needed for static/TLS
-        for (string_size k = 0; k < base64_chars.length(); k++)
+        if (i == 0 && in_len - in_ >= 16)
         {
-            uchar = base64_chars[k]; // make compiler happy
-            dtable[uchar] = k;  // decode (find)
-            itable[uchar] = 1;  // is_base64
+            string_size consumed = base64DecodeBlocks(src + in_, in_len - in_, dst + out, accept_urlsafe);
+            in_ += consumed;
+            out += consumed / 4 * 3;
+            if (in_ == in_len || src[in_] == '=')
+                break;
         }
-        const unsigned char dash = '-', add = '+', under = '_', slash = '/';
-        // Add urlsafe table
-        dtable[dash] = dtable[add]; itable[dash] = 2;
-        dtable[under] = dtable[slash]; itable[under] = 2;
-        table_ready = 1;
-    }
-
-    while (in_len-- && (encoded_string[in_] != '='))
-    {
-        uchar = encoded_string[in_]; // make compiler happy
+        uchar = src[in_];
         if (!(accept_urlsafe ? itable[uchar] : (itable[uchar] == 1))) // break away from the while condition
         {
-            ret += uchar; // not base64 encoded data, copy to result
+            dst[out++] = uchar; // not base64 encoded data, copy to result
             in_++;
             i = 0;
             continue;
@@ -99,12 +344,9 @@ std::string base64Decode(const std::string &encoded_string, bool accept_urlsafe)
             for (string_size j = 0; j < 4; j++)
                 char_array_4[j] = dtable[char_array_4[j]];
 
-            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-            for (i = 0; (i < 3); i++)
-                ret += char_array_3[i];
+            dst[out++] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+            dst[out++] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+            dst[out++] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
             i = 0;
         }
     }
@@ -122,9 +364,10 @@ std::string base64Decode(const std::string &encoded_string, bool accept_urlsafe)
         char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
 
         for (string_size j = 0; (j < i - 1); j++)
-            ret += char_array_3[j];
+            dst[out++] = char_array_3[j];
     }
 
+    ret.resize(out);
     return ret;
 }
 
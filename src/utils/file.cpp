@@ -1,7 +1,19 @@
+#include <atomic>
 #include <string>
 #include <fstream>
+#include <map>
+#include <mutex>
 #include <sys/stat.h>
 
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#include "utils/file.h"
 #include "utils/string.h"
 
 bool isInScope(const std::string &path)
@@ -108,3 +120,158 @@ int fileWrite(const std::string &path, const std::string &content, bool overwrit
     std::fclose(fp);
     return 0;
 }
+
+int fileWriteAtomic(const std::string &path, const std::string &content)
+{
+    //write next to the destination first, so readers never see a partially written file
+    //the name is unique per process and call, so concurrent writers never share a temp file
+    static std::atomic<unsigned long> temp_counter{0};
+#ifdef _WIN32
+    const long pid = _getpid();
+#else
+    const long pid = getpid();
+#endif // _WIN32
+    std::string temp_path = path + "." + std::to_string(pid) + "." + std::to_string(temp_counter++) + ".tmp";
+    std::FILE *fp = std::fopen(temp_path.c_str(), "wb");
+    if(!fp)
+        return -1;
+    bool written = std::fwrite(content.c_str(), 1, content.size(), fp) == content.size();
+    written = std::fclose(fp) == 0 && written;
+    if(!written)
+    {
+        std::remove(temp_path.c_str());
+        return -1;
+    }
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif // _WIN32
+    if(std::rename(temp_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temp_path.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+/// files smaller than this are cheaper to copy than to map
+static constexpr off_t file_map_threshold = 64 * 1024;
+/// limits of the files kept for later views, views still being held keep theirs alive after this
+static constexpr size_t file_view_cache_size = 64;
+static constexpr size_t file_view_cache_bytes = 64 * 1024 * 1024;
+
+/// what has to stay the same for a buffer to still show the file at its path
+struct FileStamp
+{
+    dev_t dev = 0;
+    ino_t ino = 0;
+    off_t size = 0;
+    time_t mtime = 0, ctime = 0;
+    long mtime_nsec = 0, ctime_nsec = 0;
+
+    explicit FileStamp(const struct stat &st) : dev(st.st_dev), ino(st.st_ino), size(st.st_size), mtime(st.st_mtime), ctime(st.st_ctime)
+    {
+#if defined(__APPLE__)
+        mtime_nsec = st.st_mtimespec.tv_nsec;
+        ctime_nsec = st.st_ctimespec.tv_nsec;
+#elif !defined(_WIN32)
+        mtime_nsec = st.st_mtim.tv_nsec;
+        ctime_nsec = st.st_ctim.tv_nsec;
+#endif // __APPLE__
+    }
+
+    bool operator==(const FileStamp &other) const = default;
+};
+
+struct FileMapping
+{
+    FileStamp stamp;
+    std::string buffer;
+    void *mapped = nullptr;
+    size_t mapped_size = 0;
+
+    explicit FileMapping(const struct stat &st) : stamp(st) {}
+    FileMapping(const FileMapping&) = delete;
+    FileMapping& operator=(const FileMapping&) = delete;
+    ~FileMapping()
+    {
+#ifndef _WIN32
+        if(mapped)
+            munmap(mapped, mapped_size);
+#endif // _WIN32
+    }
+
+    std::string_view view() const
+    {
+        return mapped ? std::string_view(static_cast<const char*>(mapped), mapped_size) : std::string_view(buffer);
+    }
+};
+
+static std::shared_ptr<const FileMapping> mapFile(const std::string &path, const struct stat &st, bool map)
+{
+    auto mapping = std::make_shared<FileMapping>(st);
+#ifndef _WIN32
+    if(map && st.st_size >= file_map_threshold)
+    {
+        int fd = open(path.data(), O_RDONLY);
+        if(fd < 0)
+            return nullptr;
+        void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(addr != MAP_FAILED)
+        {
+            mapping->mapped = addr;
+            mapping->mapped_size = st.st_size;
+            return mapping;
+        }
+    }
+#endif // _WIN32
+    mapping->buffer = fileGet(path);
+    return mapping;
+}
+
+FileView fileView(const std::string &path, bool scope_limit, bool map)
+{
+    /// files are looked up by path, and read again when the file there is not the one kept;
+    /// inodes of removed files get reused, so the timestamps are compared to the nanosecond
+    static std::mutex mappings_mutex;
+    static std::map<std::string, std::shared_ptr<const FileMapping>, std::less<>> mappings;
+    static size_t mapped_bytes = 0;
+
+    if(scope_limit && !isInScope(path))
+        return {};
+
+    struct stat st {};
+    if(stat(path.data(), &st) != 0)
+        return {};
+    if(!S_ISREG(st.st_mode))
+        return FileView(fileGet(path));
+
+    const FileStamp stamp(st);
+    {
+        std::lock_guard<std::mutex> guard(mappings_mutex);
+        auto iter = mappings.find(path);
+        /// a mapping is only handed to callers that asked for one
+        if(iter != mappings.end() && iter->second->stamp == stamp && (map || !iter->second->mapped))
+            return {iter->second, iter->second->view()};
+    }
+
+    auto mapping = mapFile(path, st, map);
+    if(!mapping)
+        return {};
+    const size_t size = mapping->view().size();
+    if(size > file_view_cache_bytes)
+        return {mapping, mapping->view()};
+    std::lock_guard<std::mutex> guard(mappings_mutex);
+    auto &slot = mappings[path];
+    if(slot)
+        mapped_bytes -= slot->view().size();
+    slot.reset();
+    if(mappings.size() > file_view_cache_size || mapped_bytes + size > file_view_cache_bytes)
+    {
+        mappings.clear();
+        mapped_bytes = 0;
+    }
+    mappings[path] = mapping;
+    mapped_bytes += size;
+    return {mapping, mapping->view()};
+}
@@ -1,7 +1,9 @@
 #ifndef FILE_H_INCLUDED
 #define FILE_H_INCLUDED
 
+#include <memory>
 #include <string>
+#include <string_view>
 #include <string.h>
 
 #ifdef _WIN32
@@ -20,6 +22,49 @@ std::string fileGet(const std::string &path, bool scope_limit = false);
 bool fileExist(const std::string &path, bool scope_limit = false);
 bool fileCopy(const std::string &source, const std::string &dest);
 int fileWrite(const std::string &path, const std::string &content, bool overwrite);
+int fileWriteAtomic(const std::string &path, const std::string &content);
+
+/// Read-only contents of a whole file, or of a string handed over to it. Views of the same
+/// unchanged file (same path, inode, size and nanosecond mtime/ctime) share one buffer across
+/// calls and threads, so reading a file again costs a stat() and no copy. A view stays valid for
+/// as long as it is held, even after the file has changed.
+class FileView
+{
+public:
+    FileView() = default;
+    FileView(std::shared_ptr<const void> owner, std::string_view data) : owner_(std::move(owner)), data_(data) {}
+    explicit FileView(std::string content) : text_(std::make_shared<std::string>(std::move(content))), data_(*text_) {}
+
+    std::string_view view() const { return data_; }
+    const char *data() const { return data_.data(); }
+    size_t size() const { return data_.size(); }
+    bool empty() const { return data_.empty(); }
+    /// a view sharing this one's owner
+    FileView substr(size_t pos, size_t count = std::string_view::npos) const
+    {
+        FileView result = *this;
+        result.data_ = data_.substr(pos, count);
+        return result;
+    }
+    std::string str() const & { return std::string(data_); }
+    /// gives a handed over string back without copying it, unless other views still share it
+    std::string str() &&
+    {
+        if(text_ && text_.use_count() == 1 && data_.size() == text_->size())
+            return std::move(*text_);
+        return std::string(data_);
+    }
+
+private:
+    std::shared_ptr<const void> owner_;
+    std::shared_ptr<std::string> text_;
+    std::string_view data_;
+};
+
+/// Large files are memory-mapped when map is set. Only do that for files this program publishes
+/// through rename(), such as cache entries: a file truncated in place while mapped faults its
+/// readers, so files users may edit are always read into a buffer.
+FileView fileView(const std::string &path, bool scope_limit = false, bool map = false);
 
 template<typename F>
 int operateFiles(const std::string &path, F &&op)
@@ -2,6 +2,7 @@
 #define INI_READER_H_INCLUDED
 
 #include <string>
+#include <string_view>
 #include <map>
 #include <vector>
 #include <numeric>
@@ -23,27 +24,48 @@ enum
 
 class INIReader
 {
-    using ini_data_struct = std::map<std::string, std::multimap<std::string, std::string>>;
     using string_multimap = std::multimap<std::string, std::string>;
     using string_array = std::vector<std::string>;
     using string_size = std::string::size_type;
     /**
-    *  @brief A simple INI reader which utilize map and vector
-    *  to store sections and items, allowing access in logarithmic time.
+    *  @brief A simple INI reader which keeps every name and value in one text arena.
+    * Items are small records pointing into the arena, so parsing and adding lines
+    * does not allocate per item.
     */
 private:
+    /**
+    *  @brief One item, as offsets into the arena.
+    */
+    struct ini_item
+    {
+        string_size name_offset = 0, name_size = 0, value_offset = 0, value_size = 0;
+        bool noname = false;
+    };
+
+    /**
+    *  @brief Items of one section, in the order they were added.
+    * Lookups and output follow name order like a multimap would,
+    * the sorted index is only built when items were not added in that order.
+    */
+    struct ini_section
+    {
+        std::vector<ini_item> items;
+        std::vector<size_t> order;
+        bool in_order = true, order_valid = false;
+    };
+
+    using ini_data_struct = std::map<std::string, ini_section>;
+
     /**
     *  @brief Internal parsed flag.
     */
     bool parsed = false;
     std::string current_section;
     ini_data_struct ini_content;
+    std::string arena;
     string_array exclude_sections, include_sections, direct_save_sections;
     string_array section_order;
 
-    std::string cached_section;
-    ini_data_struct::iterator cached_section_content;
-
     std::string isolated_items_section;
 
     //error flags
@@ -102,6 +124,102 @@ private:
     {
         T().swap(target);
     }
+
+    inline std::string_view item_name(const ini_item &item) const
+    {
+        if(item.noname)
+            return "{NONAME}";
+        return std::string_view(arena.data() + item.name_offset, item.name_size);
+    }
+
+    inline std::string_view item_value(const ini_item &item) const
+    {
+        return std::string_view(arena.data() + item.value_offset, item.value_size);
+    }
+
+    inline string_size arena_append(std::string_view text)
+    {
+        string_size offset = arena.size();
+        arena.append(text);
+        return offset;
+    }
+
+    void add_item(ini_section &section, const ini_item &item)
+    {
+        if(section.in_order && !section.items.empty() && item_name(item) < item_name(section.items.back()))
+            section.in_order = false;
+        section.order_valid = false;
+        section.items.push_back(item);
+    }
+
+    void add_item(ini_section &section, std::string_view itemName, std::string_view itemVal)
+    {
+        ini_item item;
+        if(itemName == "{NONAME}")
+            item.noname = true;
+        else
+        {
+            item.name_offset = arena_append(itemName);
+            item.name_size = itemName.size();
+        }
+        item.value_offset = arena_append(itemVal);
+        item.value_size = itemVal.size();
+        add_item(section, item);
+    }
+
+    /**
+    *  @brief Move all items of a section to the end of another one.
+    */
+    void merge_section(ini_section &target, ini_section &source)
+    {
+        for(const ini_item &item : source.items)
+            add_item(target, item);
+        erase_elements(source.items);
+    }
+
+    /**
+    *  @brief Visit items of a section in name order, items with the same name in the order they were added.
+    */
+    template <typename F> void for_each_item(ini_section &section, F &&func)
+    {
+        if(section.in_order)
+        {
+            for(const ini_item &item : section.items)
+                func(item);
+            return;
+        }
+        if(!section.order_valid)
+        {
+            section.order.resize(section.items.size());
+            std::iota(section.order.begin(), section.order.end(), 0);
+            std::stable_sort(section.order.begin(), section.order.end(), [&](size_t a, size_t b)
+            {
+                return item_name(section.items[a]) < item_name(section.items[b]);
+            });
+            section.order_valid = true;
+        }
+        for(size_t index : section.order)
+            func(section.items[index]);
+    }
+
+    ini_section *find_section(const std::string &section)
+    {
+        auto iter = ini_content.find(section);
+        return iter == ini_content.end() ? nullptr : &iter->second;
+    }
+
+    /**
+    *  @brief Find the first item added with the exact given name.
+    */
+    const ini_item *find_item(const ini_section &section, std::string_view itemName) const
+    {
+        for(const ini_item &item : section.items)
+        {
+            if(item_name(item) == itemName)
+                return &item;
+        }
+        return nullptr;
+    }
 public:
     /**
     *  @brief set this flag to true to do a UTF8-To-GBK conversion before parsing data. Only useful in Windows.
@@ -152,6 +270,7 @@ public:
     {
         //copy contents
         ini_content = src.ini_content;
+        arena = src.arena;
         //copy status
         parsed = src.parsed;
         current_section = src.current_section;
@@ -224,11 +343,10 @@ public:
         if(content.compare(0, 3, "\xEF\xBB\xBF") == 0)
             content.erase(0, 3);
 
-        bool inExcludedSection = false, inDirectSaveSection = false, inIsolatedSection = false;
-        std::string strLine, thisSection, curSection, itemName, itemVal;
-        string_multimap itemGroup;
+        bool inExcludedSection = false, inDirectSaveSection = false, inIsolatedSection = false, escaped = false;
+        std::string thisSection, curSection, escapedLine;
+        ini_section itemGroup;
         string_array read_sections;
-        std::stringstream strStrm;
         char delimiter = getLineBreak(content);
 
         erase_all(); //first erase all data
@@ -243,50 +361,89 @@ public:
             inDirectSaveSection = chk_direct_save(curSection); //check if this section requires direct-save
             inIsolatedSection = true;
         }
-        strStrm<<content;
+
+        //items point into the content itself, only lines changed by escaping are appended after it
+        arena = std::move(content);
+        const string_size content_size = arena.size();
+        auto store = [&](std::string_view itemName, std::string_view itemVal)
+        {
+            if(escaped)
+                return add_item(itemGroup, itemName, itemVal);
+            ini_item item;
+            item.noname = itemName == "{NONAME}";
+            if(!item.noname)
+            {
+                item.name_offset = itemName.data() - arena.data();
+                item.name_size = itemName.size();
+            }
+            if(!itemVal.empty())
+            {
+                item.value_offset = itemVal.data() - arena.data();
+                item.value_size = itemVal.size();
+            }
+            add_item(itemGroup, item);
+        };
+        auto finish_section = [&](bool final_section)
+        {
+            if(curSection.empty() || (!keep_empty_section && itemGroup.items.empty()))
+                return true;
+            ini_section *existing = find_section(curSection);
+            if(existing) //a section with the same name has been inserted
+            {
+                if(allow_dup_section_titles || (final_section ? isolated_items_section == thisSection : existing->items.empty()))
+                    merge_section(*existing, itemGroup); //move new items to this section
+                else if(!existing->items.empty())
+                    return false; //not allowed, stop
+            }
+            else if(!inIsolatedSection || isolated_items_section != thisSection)
+            {
+                if(!itemGroup.items.empty())
+                    read_sections.push_back(curSection); //add to read sections list
+                if(std::find(section_order.cbegin(), section_order.cend(), curSection) == section_order.cend())
+                    section_order.emplace_back(curSection); //add to section order if not added before
+                ini_content.emplace(std::move(curSection), std::move(itemGroup)); //insert this section to content map
+            }
+            return true;
+        };
+
         last_error_index = 0; //reset error index
-        while(getline(strStrm, strLine, delimiter)) //get one line of content
+        string_size line_begin = 0;
+        while(line_begin < content_size) //get one line of content
         {
+            string_size line_end = arena.find(delimiter, line_begin);
+            if(line_end > content_size)
+                line_end = content_size;
+            std::string_view strLine(arena.data() + line_begin, line_end - line_begin);
+            line_begin = line_end + 1;
             last_error_index++;
-            strLine = trimWhitespace(strLine);
+
+            string_size line_last = strLine.find_last_not_of(" \t\f\v\n\r");
+            strLine = line_last == std::string_view::npos ? std::string_view() : strLine.substr(0, line_last + 1);
             string_size lineSize = strLine.size(), pos_equal = strLine.find('=');
             if((!lineSize || strLine[0] == ';' || strLine[0] == '#' || (lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')) && !inDirectSaveSection) //empty lines and comments are ignored
                 continue;
-            processEscapeChar(strLine);
-            if(strLine[0] == '[' && strLine[lineSize - 1] == ']') //is a section title
+            escaped = strLine.find('\\') != std::string_view::npos;
+            if(escaped)
+            {
+                escapedLine.assign(strLine);
+                processEscapeChar(escapedLine);
+                strLine = escapedLine;
+            }
+            if(lineSize && lineSize <= strLine.size() && strLine[0] == '[' && strLine[lineSize - 1] == ']') //is a section title
             {
                 thisSection = strLine.substr(1, lineSize - 2); //save section title
                 inExcludedSection = chk_ignore(thisSection); //check if this section is excluded
                 inDirectSaveSection = chk_direct_save(thisSection); //check if this section requires direct-save
 
-                if(!curSection.empty() && (keep_empty_section || !itemGroup.empty())) //just finished reading a section
-                {
-                    if(ini_content.find(curSection) != ini_content.end()) //a section with the same name has been inserted
-                    {
-                        if(allow_dup_section_titles || ini_content.at(curSection).empty())
-                        {
-                            auto iter = ini_content.at(curSection); //get the existing section
-                            iter.merge(itemGroup); //move new items to this section
-                        }
-                        else if(!ini_content.at(curSection).empty())
-                            return save_error_and_return(INIREADER_EXCEPTION_DUPLICATE); //not allowed, stop
-                    }
-                    else if(!inIsolatedSection || isolated_items_section != thisSection)
-                    {
-                        if(!itemGroup.empty())
-                            read_sections.push_back(curSection); //add to read sections list
-                        if(std::find(section_order.cbegin(), section_order.cend(), curSection) == section_order.cend())
-                            section_order.emplace_back(curSection); //add to section order if not added before
-                        ini_content.emplace(std::move(curSection), std::move(itemGroup)); //insert previous section to content map
-                    }
-                }
+                if(!finish_section(false)) //just finished reading a section
+                    return save_error_and_return(INIREADER_EXCEPTION_DUPLICATE);
                 inIsolatedSection = false;
-                erase_elements(itemGroup); //reset section storage
+                itemGroup = ini_section(); //reset section storage
                 curSection = thisSection; //start a new section
             }
             else if(((store_any_line && pos_equal == std::string::npos) || inDirectSaveSection) && !inExcludedSection && !curSection.empty()) //store a line without name
             {
-                itemGroup.emplace("{NONAME}", strLine);
+                store("{NONAME}", strLine);
             }
             else if(pos_equal != std::string::npos) //is an item
             {
@@ -295,39 +452,20 @@ public:
                 if(curSection.empty()) //not in any section
                     return save_error_and_return(INIREADER_EXCEPTION_OUTOFBOUND);
                 string_size pos_value = strLine.find_first_not_of(' ', pos_equal + 1);
-                itemName = trim(strLine.substr(0, pos_equal));
+                std::string_view itemName = strLine.substr(0, pos_equal);
+                string_size name_begin = itemName.find_first_not_of(' ');
+                if(name_begin != std::string_view::npos)
+                    itemName = itemName.substr(name_begin, itemName.find_last_not_of(' ') - name_begin + 1);
                 if(pos_value != std::string::npos) //not a key with empty value
-                {
-                    itemVal = strLine.substr(pos_value);
-                    itemGroup.emplace(std::move(itemName), std::move(itemVal)); //insert to current section
-                }
+                    store(itemName, strLine.substr(pos_value)); //insert to current section
                 else
-                    itemGroup.emplace(std::move(itemName), "");
+                    store(itemName, "");
             }
             if(!include_sections.empty() && include_sections == read_sections) //all included sections has been read
                 break; //exit now
         }
-        if(!curSection.empty() && (keep_empty_section || !itemGroup.empty())) //final section
-        {
-            if(ini_content.find(curSection) != ini_content.end()) //a section with the same name has been inserted
-            {
-                if(allow_dup_section_titles || isolated_items_section == thisSection)
-                {
-                    auto &iter = ini_content.at(curSection); //get the existing section
-                    iter.merge(itemGroup); //move new items to this section
-                }
-                else if(!ini_content.at(curSection).empty())
-                    return save_error_and_return(INIREADER_EXCEPTION_DUPLICATE); //not allowed, stop
-            }
-            else if(!inIsolatedSection || isolated_items_section != thisSection)
-            {
-                if(!itemGroup.empty())
-                    read_sections.emplace_back(curSection); //add to read sections list
-                if(std::find(section_order.cbegin(), section_order.cend(), curSection) == section_order.cend())
-                    section_order.emplace_back(curSection); //add to section order if not added before
-                ini_content.emplace(std::move(curSection), std::move(itemGroup)); //insert this section to content map
-            }
-        }
+        if(!finish_section(true)) //final section
+            return save_error_and_return(INIREADER_EXCEPTION_DUPLICATE);
         parsed = true;
         return save_error_and_return(INIREADER_EXCEPTION_NONE); //all done
     }
@@ -367,14 +505,13 @@ public:
     }
 
     /**
-    *  @brief Enter a section with the given name. Section name and data will be cached to speed up the following reading process.
+    *  @brief Enter a section with the given name.
     */
     int enter_section(const std::string &section)
     {
         if(!section_exist(section))
             return save_error_and_return(INIREADER_EXCEPTION_NOTEXIST);
-        current_section = cached_section = section;
-        cached_section_content = ini_content.find(section);
+        current_section = section;
         return save_error_and_return(INIREADER_EXCEPTION_NONE);
     }
 
@@ -391,16 +528,8 @@ public:
     */
     bool item_exist(const std::string &section, const std::string &itemName)
     {
-        if(!section_exist(section))
-            return false;
-
-        if(section != cached_section)
-        {
-            cached_section = section;
-            cached_section_content = ini_content.find(section);
-        }
-        auto &cache = cached_section_content->second;
-        return cache.find(itemName) != cache.end();
+        ini_section *items = find_section(section);
+        return items && find_item(*items, itemName);
     }
 
     /**
@@ -416,19 +545,12 @@ public:
     */
     bool item_prefix_exists(const std::string &section, const std::string &itemName)
     {
-        if(!section_exist(section))
+        ini_section *items = find_section(section);
+        if(!items)
             return false;
 
-        if(section != cached_section)
-        {
-            cached_section = section;
-            cached_section_content = ini_content.find(section);
-        }
-
-        auto &items = cached_section_content->second;
-
-        return std::any_of(items.cbegin(), items.cend(), [&](auto &x) {
-            return x.first.find(itemName) == 0;
+        return std::any_of(items->items.cbegin(), items->items.cend(), [&](auto &x) {
+            return item_name(x).compare(0, itemName.size(), itemName) == 0;
         });
     }
 
@@ -448,7 +570,7 @@ public:
         if(!parsed || !section_exist(section))
             return save_error_and_return(INIREADER_EXCEPTION_NOTPARSED);
 
-        return ini_content.at(section).size();
+        return ini_content.at(section).items.size();
     }
 
     /**
@@ -458,34 +580,24 @@ public:
     {
         erase_elements(ini_content);
         erase_elements(section_order);
-        cached_section.clear();
-        cached_section_content = ini_content.end();
+        erase_elements(arena);
         parsed = false;
     }
 
-    ini_data_struct::iterator get_items_ref(const std::string &section)
-    {
-        if(!parsed || !section_exist(section))
-            return ini_content.end();
-
-        if(cached_section != section)
-        {
-            cached_section = section;
-            cached_section_content = ini_content.find(section);
-        }
-        return cached_section_content;
-    }
-
     /**
     *  @brief Retrieve all items in the given section.
     */
     int get_items(const std::string &section, string_multimap &data)
     {
-        auto section_ref = get_items_ref(section);
-        if(section_ref == ini_content.end())
+        ini_section *items = parsed ? find_section(section) : nullptr;
+        if(!items)
             return save_error_and_return(INIREADER_EXCEPTION_NOTEXIST);
 
-        data = section_ref->second;
+        data.clear();
+        for_each_item(*items, [&](const ini_item &x)
+        {
+            data.emplace_hint(data.end(), item_name(x), item_value(x));
+        });
         return save_error_and_return(INIREADER_EXCEPTION_NONE);
     }
 
@@ -505,15 +617,15 @@ public:
         if(!parsed)
             return save_error_and_return(INIREADER_EXCEPTION_NOTPARSED);
 
-        auto section_ref = get_items_ref(section);
-        if(section_ref == ini_content.end())
+        ini_section *items = find_section(section);
+        if(!items)
             return save_error_and_return(INIREADER_EXCEPTION_NOTEXIST);
 
-        for(auto &x : section_ref->second)
+        for_each_item(*items, [&](const ini_item &x)
         {
-            if(x.first.find(itemName) == 0)
-                results.emplace_back(x.second);
-        }
+            if(item_name(x).compare(0, itemName.size(), itemName) == 0)
+                results.emplace_back(item_value(x));
+        });
 
         return save_error_and_return(INIREADER_EXCEPTION_NONE);
     }
@@ -531,19 +643,13 @@ public:
     */
     std::string get(const std::string &section, const std::string &itemName) //retrieve one item with the exact same itemName
     {
-        if(!parsed || !section_exist(section))
+        ini_section *items = parsed ? find_section(section) : nullptr;
+        if(!items)
             return "";
 
-        if(cached_section != section)
-        {
-            cached_section = section;
-            cached_section_content = ini_content.find(section);
-        }
-
-        auto &cache = cached_section_content->second;
-        auto iter = std::find_if(cache.begin(), cache.end(), [&](auto x) { return x.first == itemName; });
-        if(iter != cache.end())
-            return iter->second;
+        const ini_item *item = find_item(*items, itemName);
+        if(item)
+            return std::string(item_value(*item));
 
         return "";
     }
@@ -564,9 +670,11 @@ public:
         if(!parsed)
             return save_error_and_return(INIREADER_EXCEPTION_NOTPARSED);
 
-        if(item_exist(section, itemName))
+        ini_section *items = find_section(section);
+        const ini_item *item = items ? find_item(*items, itemName) : nullptr;
+        if(item)
         {
-            target = get(section, itemName);
+            target = item_value(*item);
             return save_error_and_return(INIREADER_EXCEPTION_NONE);
         }
 
@@ -681,7 +789,7 @@ public:
         if(!parsed)
             return "";
         string_array result;
-        if(get_all(section, itemName, result) != -1)
+        if(get_all(section, itemName, result) == INIREADER_EXCEPTION_NONE && !result.empty())
             return result[0];
         else
             return "";
@@ -720,7 +828,7 @@ public:
     /**
     *  @brief Add a std::string value with given values.
     */
-    int set(const std::string &section, std::string itemName, std::string itemVal)
+    int set(const std::string &section, std::string_view itemName, std::string_view itemVal)
     {
         if(section.empty())
             return save_error_and_return(INIREADER_EXCEPTION_NOTEXIST);
@@ -728,18 +836,13 @@ public:
         if(!parsed)
             parsed = true;
 
-        if(section_exist(section))
+        ini_section *items = find_section(section);
+        if(!items)
         {
-            string_multimap &mapTemp = ini_content.at(section);
-            mapTemp.insert(std::pair<std::string, std::string>(std::move(itemName), std::move(itemVal)));
-        }
-        else
-        {
-            string_multimap mapTemp;
-            mapTemp.insert(std::pair<std::string, std::string>(std::move(itemName), std::move(itemVal)));
-            ini_content.insert(std::pair<std::string, std::multimap<std::string, std::string>>(section, std::move(mapTemp)));
+            items = &ini_content[section];
             section_order.emplace_back(section);
         }
+        add_item(*items, itemName, itemVal);
 
         return save_error_and_return(INIREADER_EXCEPTION_NONE);
     }
@@ -747,11 +850,11 @@ public:
     /**
     *  @brief Add a string value with given values.
     */
-    int set(std::string itemName, std::string itemVal)
+    int set(std::string_view itemName, std::string_view itemVal)
     {
         if(current_section.empty())
             return save_error_and_return(INIREADER_EXCEPTION_NOTEXIST);
-        return set(current_section, std::move(itemName), std::move(itemVal));
+        return set(current_section, itemName, itemVal);
     }
 
     /**
@@ -840,14 +943,14 @@ public:
     */
     int erase(const std::string &section, const std::string &itemName)
     {
-        if(!section_exist(section))
+        ini_section *items = find_section(section);
+        if(!items)
             return save_error_and_return(INIREADER_EXCEPTION_NOTEXIST);
 
-        auto retVal = ini_content.at(section).erase(itemName);
-        if(retVal && cached_section == section)
-        {
-            cached_section_content = ini_content.find(section);
-        }
+        auto iter = std::remove_if(items->items.begin(), items->items.end(), [&](const ini_item &x) { return item_name(x) == itemName; });
+        int retVal = std::distance(iter, items->items.end());
+        items->items.erase(iter, items->items.end());
+        items->order_valid = false;
         return retVal;
     }
 
@@ -864,11 +967,12 @@ public:
     */
     int erase_first(const std::string &section, const std::string &itemName)
     {
-        string_multimap &mapTemp = ini_content.at(section);
-        auto iter = mapTemp.find(itemName);
-        if(iter != mapTemp.end())
+        ini_section *items = find_section(section);
+        const ini_item *item = items ? find_item(*items, itemName) : nullptr;
+        if(item)
         {
-            mapTemp.erase(iter);
+            items->items.erase(items->items.begin() + (item - items->items.data()));
+            items->order_valid = false;
             return save_error_and_return(INIREADER_EXCEPTION_NONE);
         }
         else
@@ -890,14 +994,9 @@ public:
     */
     void erase_section(const std::string &section)
     {
-        if(ini_content.find(section) == ini_content.end())
-            return;
-        erase_elements(ini_content.at(section));
-        if(cached_section == section)
-        {
-            cached_section_content = ini_content.end();
-            cached_section.erase();
-        }
+        ini_section *items = find_section(section);
+        if(items)
+            *items = ini_section();
     }
 
     /**
@@ -914,15 +1013,11 @@ public:
     */
     void remove_section(const std::string &section)
     {
-        if(ini_content.find(section) == ini_content.end())
+        if(ini_content.erase(section) == 0)
             return;
-        ini_content.erase(section);
-        if(cached_section == section)
-        {
-            cached_section.clear();
-            cached_section_content = ini_content.end();
-        }
-        section_order.erase(std::find(section_order.begin(), section_order.end(), section));
+        auto iter = std::find(section_order.begin(), section_order.end(), section);
+        if(iter != section_order.end())
+            section_order.erase(iter);
     }
 
     /**
@@ -939,33 +1034,44 @@ public:
     */
     std::string to_string()
     {
-        std::string content, itemVal;
+        std::string content;
 
         if(!parsed)
             return "";
 
+        content.reserve(arena.size() + section_order.size() * 16);
         for(auto &x : section_order)
         {
             string_size strsize = 0;
             content += "[" + x + "]\n";
-            if(ini_content.find(x) != ini_content.end())
+            ini_section *section = find_section(x);
+            if(section)
             {
-                auto section = ini_content.at(x);
-                if(section.empty())
+                if(section->items.empty())
                 {
                     content += "\n";
                     continue;
                 }
-                for(auto iter = section.begin(); iter != section.end(); iter++)
+                for_each_item(*section, [&](const ini_item &item)
                 {
-                    if(iter->first != "{NONAME}")
-                        content += iter->first + "=";
-                    itemVal = iter->second;
-                    processEscapeCharReverse(itemVal);
-                    content += itemVal + "\n";
-                    if(std::next(iter) == section.end())
-                        strsize = itemVal.size();
-                }
+                    if(!item.noname)
+                    {
+                        content += item_name(item);
+                        content += '=';
+                    }
+                    //same as processEscapeCharReverse(), written straight into the output
+                    std::string_view itemVal = item_value(item);
+                    string_size begin = 0, pos;
+                    while((pos = itemVal.find_first_of("\n\r\t", begin)) != std::string_view::npos)
+                    {
+                        content += itemVal.substr(begin, pos - begin);
+                        content += itemVal[pos] == '\n' ? "\\n" : itemVal[pos] == '\r' ? "\\r" : "\\t";
+                        begin = pos + 1;
+                    }
+                    content += itemVal.substr(begin);
+                    content += '\n';
+                    strsize = itemVal.size();
+                });
             }
             if(strsize)
                 content += "\n";
@@ -2,10 +2,11 @@
 #define MD5_INTERFACE_H_INCLUDED
 
 #include <string>
+#include <string_view>
 
 #include "md5.h"
 
-inline std::string getMD5(const std::string &data)
+inline std::string getMD5(std::string_view data)
 {
     std::string result;
 
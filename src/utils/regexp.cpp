@@ -219,6 +219,29 @@ std::vector<std::string> regGetAllMatch(const std::string &src, const std::strin
 
 //#endif // USE_STD_REGEX
 
+struct RegexReplacer::Code
+{
+    /// compiled like regMatch() and regReplace() do
+    jp::Regex full, reg;
+};
+
+RegexReplacer::RegexReplacer(const std::string &match, const std::string &replace) : replace(replace)
+{
+    auto compiled = std::make_shared<Code>();
+    compiled->full.setPattern(match).addModifier("m").addPcre2Option(PCRE2_ANCHORED|PCRE2_ENDANCHORED|PCRE2_UTF).compile();
+    compiled->reg.setPattern(match).addModifier("m").addPcre2Option(PCRE2_UTF|PCRE2_MULTILINE|PCRE2_ALT_BSUX).compile();
+    if(compiled->full && compiled->reg)
+        code = std::move(compiled);
+}
+
+bool RegexReplacer::matchReplace(const std::string &src, std::string &result) const
+{
+    if(!code || !code->full.match(src, "g"))
+        return false;
+    result = code->reg.replace(src, replace, "gEx");
+    return true;
+}
+
 std::string regTrim(const std::string &src)
 {
     return regReplace(src, R"(^\s*([\s\S]*)\s*$)", "$1", false, false);
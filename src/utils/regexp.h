@@ -1,7 +1,9 @@
 #ifndef REGEXP_H_INCLUDED
 #define REGEXP_H_INCLUDED
 
+#include <memory>
 #include <string>
+#include <vector>
 
 bool regValid(const std::string &reg);
 bool regFind(const std::string &src, const std::string &match);
@@ -11,4 +13,22 @@ int regGetMatch(const std::string &src, const std::string &match, size_t group_c
 std::vector<std::string> regGetAllMatch(const std::string &src, const std::string &match, bool group_only = false);
 std::string regTrim(const std::string &src);
 
+/// A match/replace pair compiled once, for rules applied to many strings.
+/// Copies share the compiled pattern and may be used from several threads.
+class RegexReplacer
+{
+public:
+    RegexReplacer(const std::string &match, const std::string &replace);
+    bool valid() const { return !!code; }
+    /// same as regMatch() followed by regReplace() with the defaults, without compiling the pattern again;
+    /// returns false and leaves result alone if src is no full match
+    bool matchReplace(const std::string &src, std::string &result) const;
+private:
+    struct Code;
+    std::shared_ptr<Code> code;
+    std::string replace;
+};
+
+using RegexReplacers = std::vector<RegexReplacer>;
+
 #endif // REGEXP_H_INCLUDED
@@ -2,6 +2,7 @@
 #define STRING_HASH_H_INCLUDED
 
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 using hash_t = uint64_t;
@@ -26,6 +27,17 @@ inline hash_t hash_(const std::string &str)
     return hash_(str.data());
 }
 
+inline hash_t hash_(std::string_view str)
+{
+    hash_t ret{basis};
+    for(char c : str)
+    {
+        ret ^= c;
+        ret *= prime;
+    }
+    return ret;
+}
+
 constexpr hash_t hash_compile_time(char const* str, hash_t last_value = basis)
 {
     return *str ? hash_compile_time(str + 1, (*str ^ last_value) * prime) : last_value;
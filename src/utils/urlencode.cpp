@@ -1,6 +1,124 @@
 #include <string>
+#include <string_view>
+#include <algorithm>
 
 #include "string.h"
+#include "urlencode.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define URLENCODE_X86_SIMD
+#include <immintrin.h>
+#endif // URLENCODE_X86_SIMD
+
+/// bytes copied as-is by urlEncode(), same as isalnum() in the C locale plus "-_.~"
+static constexpr struct UrlCharTable
+{
+    bool unreserved[256] {};
+    bool alnum[256] {};
+
+    constexpr UrlCharTable()
+    {
+        for(int c = '0'; c <= '9'; c++)
+            alnum[c] = true;
+        for(int c = 'A'; c <= 'Z'; c++)
+            alnum[c] = alnum[c + 32] = true;
+        for(int c = 0; c < 256; c++)
+            unreserved[c] = alnum[c];
+        unreserved[(unsigned char)'-'] = unreserved[(unsigned char)'_'] = unreserved[(unsigned char)'.'] = unreserved[(unsigned char)'~'] = true;
+    }
+} url_chars;
+
+#ifdef URLENCODE_X86_SIMD
+
+/// SIMD kernels only measure how many leading bytes can be copied unchanged,
+/// the escaping itself is left to the scalar loops below.
+
+static bool urlSSE2Supported()
+{
+    static const bool supported = []
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    }();
+    return supported;
+}
+
+__attribute__((target("sse2")))
+static inline __m128i inRangeSSE(__m128i in, char low, char high)
+{
+    /// signed compares keep bytes >= 0x80 out of every ASCII range
+    return _mm_andnot_si128(_mm_or_si128(_mm_cmplt_epi8(in, _mm_set1_epi8(low)), _mm_cmpgt_epi8(in, _mm_set1_epi8(high))), _mm_set1_epi8(-1));
+}
+
+__attribute__((target("sse2")))
+static string_size urlUnreservedRunSSE(const char *src, string_size len)
+{
+    string_size consumed = 0;
+    while(len - consumed >= 16)
+    {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + consumed));
+        __m128i ok = _mm_or_si128(inRangeSSE(in, '0', '9'), inRangeSSE(_mm_or_si128(in, _mm_set1_epi8(0x20)), 'a', 'z'));
+        ok = _mm_or_si128(ok, _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('-')), _mm_cmpeq_epi8(in, _mm_set1_epi8('_'))));
+        ok = _mm_or_si128(ok, _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('.')), _mm_cmpeq_epi8(in, _mm_set1_epi8('~'))));
+        unsigned int mask = ~_mm_movemask_epi8(ok) & 0xFFFF;
+        if(mask)
+            return consumed + __builtin_ctz(mask);
+        consumed += 16;
+    }
+    return consumed;
+}
+
+__attribute__((target("sse2")))
+static string_size urlPlainRunSSE(const char *src, string_size len)
+{
+    string_size consumed = 0;
+    while(len - consumed >= 16)
+    {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + consumed));
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('%')), _mm_cmpeq_epi8(in, _mm_set1_epi8('+')));
+        unsigned int mask = _mm_movemask_epi8(special);
+        if(mask)
+            return consumed + __builtin_ctz(mask);
+        consumed += 16;
+    }
+    return consumed;
+}
+
+#endif // URLENCODE_X86_SIMD
+
+/// length of the leading run that urlEncode() copies unchanged
+static string_size urlUnreservedRun(const char *src, string_size len)
+{
+    string_size consumed = 0;
+#ifdef URLENCODE_X86_SIMD
+    if(urlSSE2Supported())
+    {
+        consumed = urlUnreservedRunSSE(src, len);
+        if(consumed + 16 <= len)
+            return consumed;
+    }
+#endif // URLENCODE_X86_SIMD
+    while(consumed < len && url_chars.unreserved[(unsigned char)src[consumed]])
+        consumed++;
+    return consumed;
+}
+
+/// length of the leading run that urlDecode() copies unchanged
+static string_size urlPlainRun(const char *src, string_size len)
+{
+    string_size consumed = 0;
+#ifdef URLENCODE_X86_SIMD
+    if(urlSSE2Supported())
+    {
+        consumed = urlPlainRunSSE(src, len);
+        if(consumed + 16 <= len)
+            return consumed;
+    }
+#endif // URLENCODE_X86_SIMD
+    while(consumed < len && src[consumed] != '%' && src[consumed] != '+')
+        consumed++;
+    return consumed;
+}
 
 unsigned char toHex(unsigned char x)
 {
@@ -23,22 +141,20 @@ unsigned char fromHex(unsigned char x)
 
 std::string urlEncode(const std::string& str)
 {
-    std::string strTemp = "";
-    string_size length = str.length();
-    for (string_size i = 0; i < length; i++)
+    std::string strTemp;
+    const char *src = str.data();
+    string_size length = str.length(), i = 0;
+    strTemp.reserve(length + length / 2);
+    while (i < length)
     {
-        if (isalnum((unsigned char)str[i]) ||
-                (str[i] == '-') ||
-                (str[i] == '_') ||
-                (str[i] == '.') ||
-                (str[i] == '~'))
-            strTemp += str[i];
-        else
-        {
-            strTemp += '%';
-            strTemp += toHex((unsigned char)str[i] >> 4);
-            strTemp += toHex((unsigned char)str[i] % 16);
-        }
+        string_size run = urlUnreservedRun(src + i, length - i);
+        strTemp.append(src + i, run);
+        i += run;
+        if (i >= length)
+            break;
+        unsigned char c = src[i++];
+        char escaped[3] = {'%', (char)toHex(c >> 4), (char)toHex(c % 16)};
+        strTemp.append(escaped, 3);
     }
     return strTemp;
 }
@@ -46,26 +162,32 @@ std::string urlEncode(const std::string& str)
 std::string urlDecode(const std::string& str)
 {
     std::string strTemp;
-    string_size length = str.length();
-    for (string_size i = 0; i < length; i++)
+    const char *src = str.data();
+    string_size length = str.length(), i = 0;
+    strTemp.reserve(length);
+    while (i < length)
     {
-        if (str[i] == '+')
+        string_size run = urlPlainRun(src + i, length - i);
+        strTemp.append(src + i, run);
+        i += run;
+        if (i >= length)
+            break;
+        if (src[i] == '+')
             strTemp += ' ';
-        else if (str[i] == '%')
+        else
         {
             if(i + 2 >= length)
                 return strTemp;
-            if(isalnum(str[i + 1]) && isalnum(str[i + 2]))
+            if(url_chars.alnum[(unsigned char)src[i + 1]] && url_chars.alnum[(unsigned char)src[i + 2]])
             {
-                unsigned char high = fromHex((unsigned char)str[++i]);
-                unsigned char low = fromHex((unsigned char)str[++i]);
+                unsigned char high = fromHex((unsigned char)src[++i]);
+                unsigned char low = fromHex((unsigned char)src[++i]);
                 strTemp += high * 16 + low;
             }
             else
-                strTemp += str[i];
+                strTemp += src[i];
         }
-        else
-            strTemp += str[i];
+        i++;
     }
     return strTemp;
 }
@@ -83,3 +205,35 @@ std::string joinArguments(const string_multimap &args)
     }
     return strTemp;
 }
+
+UrlArgs::UrlArgs(std::string_view query)
+{
+    /// an argument starts at the beginning or after '&' or '?', and its value runs to the next '&'
+    string_size start = 0;
+    while (start <= query.size())
+    {
+        string_size stop = query.find_first_of("=&?", start);
+        if (stop == std::string_view::npos)
+            break;
+        if (query[stop] == '=')
+        {
+            string_size value_end = std::min(query.find('&', stop + 1), query.size());
+            args_.emplace_back(query.substr(start, stop - start), query.substr(stop + 1, value_end - stop - 1));
+            stop = query.find_first_of("&?", stop + 1);
+            if (stop == std::string_view::npos)
+                break;
+        }
+        start = stop + 1;
+    }
+}
+
+std::string UrlArgs::get(std::string_view name) const
+{
+    /// the last match wins, same as getUrlArg()
+    for (auto iter = args_.rbegin(); iter != args_.rend(); ++iter)
+    {
+        if (iter->first == name)
+            return std::string(iter->second);
+    }
+    return "";
+}
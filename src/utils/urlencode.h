@@ -2,6 +2,9 @@
 #define URLENCODE_H_INCLUDED
 
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "utils/string.h"
 
@@ -9,4 +12,19 @@ std::string urlEncode(const std::string& str);
 std::string urlDecode(const std::string& str);
 std::string joinArguments(const string_multimap &args);
 
+/// Arguments of a query string, split in one pass and then looked up by name.
+/// Matches what getUrlArg() returns for the same string, without rescanning it
+/// for every name. Names and values point into the query, which must outlive this.
+class UrlArgs
+{
+public:
+    UrlArgs() = default;
+    explicit UrlArgs(std::string_view query);
+
+    std::string get(std::string_view name) const;
+
+private:
+    std::vector<std::pair<std::string_view, std::string_view>> args_;
+};
+
 #endif // URLENCODE_H_INCLUDED